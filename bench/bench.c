@@ -0,0 +1,465 @@
+/**
+ * @file bench.c
+ * @brief Parameter sweep benchmark of X-Lock
+ *
+ * This program measures gen and rep over every combination of the
+ * given parameter lists. Every configuration is enrolled once, warmed
+ * up, then run with seeds derived from a fixed base seed, so that two
+ * runs of the benchmark with the same arguments do the same work.
+ * Results are printed as CSV or JSON, one record per configuration.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "../include/bits.h"
+#include "../include/indexes.h"
+#include "../include/xlock.h"
+#include "../include/context.h"
+#include "../include/tictoc.h"
+
+/**
+ * @brief maximum length of a parameter list
+ */
+#define BENCH_LIST 32
+
+/**
+ * @brief key length in bytes
+ */
+#define BENCH_KEY_BYTES 32
+
+/**
+ * @brief robustness token length in bytes
+ */
+#define BENCH_TOKEN_BYTES 32
+
+/**
+ * @brief list of values of a swept parameter
+ */
+struct bench_list
+{
+    unsigned int n;          /**< number of values */
+    double v[BENCH_LIST];    /**< values */
+};
+
+/**
+ * @brief options of the benchmark
+ */
+struct bench_opts
+{
+    struct bench_list locks;        /**< n_locks values */
+    struct bench_list xorations;    /**< n_xoration values */
+    struct bench_list key_pre;      /**< key_pre_bits values */
+    struct bench_list source_bytes; /**< source_bytes values */
+    struct bench_list e_abs;        /**< e_abs values */
+    unsigned int pool_bytes;        /**< pool length in bytes */
+    unsigned int runs;              /**< measured runs per configuration */
+    unsigned int warmup;            /**< unmeasured runs per configuration */
+    unsigned long seed;             /**< base seed */
+    int json;                       /**< print JSON instead of CSV */
+};
+
+/**
+ * @brief results of a configuration
+ */
+struct bench_result
+{
+    double gen_us[3];      /**< p50, p99 and p999 of gen in microseconds */
+    double rep_us[3];      /**< p50, p99 and p999 of rep in microseconds */
+    double rep_per_s;      /**< rep throughput in calls per second */
+    size_t helper_bytes;   /**< public helper data per key */
+    size_t scratch_bytes;  /**< context scratch memory */
+    double failure_rate;   /**< share of runs where rep failed */
+    const char *error;     /**< cause of a failed configuration, or NULL */
+};
+
+/**
+ * @brief percentiles reported for gen and rep
+ */
+static double bench_percentiles[3] = {0.5, 0.99, 0.999};
+
+/**
+ * @brief parses a comma-separated list of numbers
+ *
+ * @param s list
+ * @param list storage for the values
+ * @return 0 on success, -1 if s is not a list of numbers
+ */
+int bench_parse_list(char *s, struct bench_list *list)
+{
+    char *end;
+
+    list->n = 0;
+    while (*s)
+    {
+        if (list->n == BENCH_LIST)
+            return -1;
+        list->v[list->n++] = strtod(s, &end);
+        if (end == s || (*end && *end != ','))
+            return -1;
+        s = *end ? end + 1 : end;
+    }
+
+    return list->n ? 0 : -1;
+}
+
+/**
+ * @brief parses a comma-separated list of positive integers
+ *
+ * @param s list
+ * @param list storage for the values
+ * @param max largest value accepted
+ * @return 0 on success, -1 if s is not a list of integers in [1, max]
+ */
+int bench_parse_uints(char *s, struct bench_list *list, unsigned int max)
+{
+    unsigned int i;
+
+    if (bench_parse_list(s, list))
+        return -1;
+
+    /* the range is checked first, casting is undefined out of it, NaN included */
+    for (i = 0; i < list->n; i++)
+    {
+        if (!(list->v[i] >= 1 && list->v[i] <= max) || list->v[i] != (unsigned int)list->v[i])
+            return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief compares two doubles for qsort()
+ *
+ * @param a first double
+ * @param b second double
+ * @return -1, 0 or 1 if a is less, equal or greater than b
+ */
+int bench_cmp(const void *a, const void *b)
+{
+    double x = *(const double *)a, y = *(const double *)b;
+
+    return (x > y) - (x < y);
+}
+
+/**
+ * @brief computes the percentiles of a set of latencies
+ *
+ * @param t latencies, sorted in place
+ * @param n number of latencies
+ * @param out storage for the percentiles in bench_percentiles
+ * @return void
+ */
+void bench_summarize(double *t, unsigned int n, double *out)
+{
+    unsigned int i, k;
+
+    qsort(t, n, sizeof(double), bench_cmp);
+    for (i = 0; i < 3; i++)
+    {
+        /* nearest rank */
+        k = (unsigned int)(bench_percentiles[i] * n + 0.999999);
+        out[i] = t[k ? k - 1 : 0];
+    }
+}
+
+/**
+ * @brief returns the elapsed time in microseconds
+ *
+ * @param start start time
+ * @param end end time
+ * @return end - start in microseconds
+ */
+double bench_us(struct timespec start, struct timespec end)
+{
+    return TIC_TOC(start, end) * 1000;
+}
+
+/**
+ * @brief benchmarks one configuration
+ *
+ * @param opts options
+ * @param params X-Lock parameters
+ * @param source_bytes source length in bytes
+ * @param e_abs absolute error probability
+ * @param res storage for the results
+ * @return 0 on success, -1 if params are invalid, memory is short, or
+ * enrollment or gen fails, with res->error set
+ */
+int bench_run(
+    struct bench_opts *opts,
+    struct xlock_params *params,
+    unsigned int source_bytes,
+    float e_abs,
+    struct bench_result *res)
+{
+    unsigned int vault_bytes, i, total = opts->warmup + opts->runs, failures = 0;
+    unsigned long source_seed, key_seed, nonce;
+    unsigned char key1[BENCH_KEY_BYTES], key2[BENCH_KEY_BYTES];
+    unsigned char token[BENCH_TOKEN_BYTES];
+    struct timespec start, end;
+    double total_rep = 0;
+    struct xlock_ctx ctx;
+    int ret = -1;
+
+    size_t scratch;
+    unsigned char *buf = NULL, *source = NULL, *read = NULL, *pool = NULL, *vault = NULL;
+    double *gen_us = NULL, *rep_us = NULL;
+
+    /* invalid parameters may ask for absurd sizes */
+    res->error = "invalid parameters";
+    if (xlock_params_check(params))
+        return -1;
+
+    vault_bytes = bits_to_bytes(params->pool_bits * params->n_locks);
+    scratch = xlock_ctx_size(params);
+    buf = malloc(scratch);
+    source = malloc(source_bytes);
+    read = malloc(source_bytes);
+    pool = malloc(bits_to_bytes(params->pool_bits));
+    vault = malloc(vault_bytes);
+    gen_us = malloc(opts->runs * sizeof(double));
+    rep_us = malloc(opts->runs * sizeof(double));
+
+    res->error = "out of memory";
+    if (!buf || !source || !read || !pool || !vault || !gen_us || !rep_us)
+        goto out;
+    res->error = "invalid parameters";
+    if (xlock_ctx_init(&ctx, params, buf, scratch))
+        goto out;
+
+    /* the same arguments enroll the same device */
+    srand(opts->seed);
+    source_seed = prng_counter(opts->seed, 0) | 1;
+    init_random(source, source_bytes);
+    init_random(pool, bits_to_bytes(params->pool_bits));
+    res->error = "enrollment failed";
+    if (xlock_ctx_enroll(&ctx, source, &source_seed, pool, vault))
+        goto out;
+
+    for (i = 0; i < total; i++)
+    {
+        key_seed = prng_counter(opts->seed, i + 1) | 1;
+
+        change_random(source, read, source_bytes, e_abs);
+        TIC(start);
+        ret = xlock_ctx_gen(&ctx, read, &source_seed, vault, key1, &key_seed, &nonce, token);
+        TOC(end);
+        if (ret)
+        {
+            res->error = "gen failed";
+            ret = -1;
+            goto out;
+        }
+        if (i >= opts->warmup)
+            gen_us[i - opts->warmup] = bench_us(start, end);
+
+        change_random(source, read, source_bytes, e_abs);
+        TIC(start);
+        ret = xlock_ctx_rep(&ctx, read, &source_seed, vault, key2, &key_seed, &nonce, token);
+        TOC(end);
+        if (i >= opts->warmup)
+        {
+            rep_us[i - opts->warmup] = bench_us(start, end);
+            total_rep += rep_us[i - opts->warmup];
+            if (ret || memcmp(key1, key2, bits_to_bytes(params->key_bits)))
+                failures++;
+        }
+    }
+
+    bench_summarize(gen_us, opts->runs, res->gen_us);
+    bench_summarize(rep_us, opts->runs, res->rep_us);
+    res->rep_per_s = total_rep ? opts->runs / (total_rep / 1e6) : 0;
+    /* vault, source seed, key seed, nonce and token */
+    res->helper_bytes = vault_bytes + 3 * sizeof(unsigned long) + params->token_bytes;
+    res->scratch_bytes = scratch;
+    res->failure_rate = (double)failures / opts->runs;
+    res->error = NULL;
+    ret = 0;
+
+out:
+    free(rep_us);
+    free(gen_us);
+    free(vault);
+    free(pool);
+    free(read);
+    free(source);
+    free(buf);
+    return ret;
+}
+
+/**
+ * @brief prints the results of a configuration
+ *
+ * @param opts options
+ * @param params X-Lock parameters
+ * @param source_bytes source length in bytes
+ * @param e_abs absolute error probability
+ * @param res results, with error set if the configuration failed
+ * @param first the configuration is the first one printed
+ * @return void
+ */
+void bench_print(
+    struct bench_opts *opts,
+    struct xlock_params *params,
+    unsigned int source_bytes,
+    float e_abs,
+    struct bench_result *res,
+    int first)
+{
+    if (opts->json)
+    {
+        printf("%s\n  {\"n_locks\": %u, \"n_xoration\": %u, \"key_pre_bits\": %u, "
+               "\"source_bytes\": %u, \"e_abs\": %g, \"runs\": %u",
+               first ? "" : ",", params->n_locks, params->n_xoration,
+               params->key_pre_bits, source_bytes, e_abs, opts->runs);
+        if (!res->error)
+            printf(", \"gen_p50_us\": %.3f, \"gen_p99_us\": %.3f, \"gen_p999_us\": %.3f, "
+                   "\"rep_p50_us\": %.3f, \"rep_p99_us\": %.3f, \"rep_p999_us\": %.3f, "
+                   "\"rep_per_s\": %.1f, \"helper_bytes\": %zu, \"scratch_bytes\": %zu, "
+                   "\"failure_rate\": %g}",
+                   res->gen_us[0], res->gen_us[1], res->gen_us[2],
+                   res->rep_us[0], res->rep_us[1], res->rep_us[2],
+                   res->rep_per_s, res->helper_bytes, res->scratch_bytes, res->failure_rate);
+        else
+            printf(", \"error\": \"%s\"}", res->error);
+        return;
+    }
+
+    if (first)
+        printf("n_locks,n_xoration,key_pre_bits,source_bytes,e_abs,runs,"
+               "gen_p50_us,gen_p99_us,gen_p999_us,rep_p50_us,rep_p99_us,rep_p999_us,"
+               "rep_per_s,helper_bytes,scratch_bytes,failure_rate,error\n");
+    printf("%u,%u,%u,%u,%g,%u", params->n_locks, params->n_xoration,
+           params->key_pre_bits, source_bytes, e_abs, opts->runs);
+    if (!res->error)
+        printf(",%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.1f,%zu,%zu,%g,\n",
+               res->gen_us[0], res->gen_us[1], res->gen_us[2],
+               res->rep_us[0], res->rep_us[1], res->rep_us[2],
+               res->rep_per_s, res->helper_bytes, res->scratch_bytes, res->failure_rate);
+    else
+        printf(",,,,,,,,,,,%s\n", res->error);
+}
+
+/**
+ * @brief prints the usage of the benchmark
+ *
+ * @param name program name
+ * @return void
+ */
+void bench_usage(char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -L, --locks LIST          n_locks values (64)\n"
+            "  -C, --xorations LIST      n_xoration values (2)\n"
+            "  -k, --key-pre LIST        key_pre_bits values (80)\n"
+            "  -s, --source-bytes LIST   source_bytes values (8004)\n"
+            "  -e, --e-abs LIST          e_abs values (0.15)\n"
+            "  -p, --pool-bytes N        pool length in bytes (32)\n"
+            "  -n, --runs N              measured runs per configuration (10000)\n"
+            "  -w, --warmup N            unmeasured runs per configuration (1000)\n"
+            "  -S, --seed N              base seed (1)\n"
+            "  -j, --json                print JSON instead of CSV\n"
+            "LIST is a comma-separated list of values, integers but for e_abs.\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    struct bench_opts opts = {
+        {1, {64}}, {1, {2}}, {1, {80}}, {1, {8004}}, {1, {0.15}},
+        32, 10000, 1000, 1, 0};
+    struct option long_opts[] = {
+        {"locks", required_argument, NULL, 'L'},
+        {"xorations", required_argument, NULL, 'C'},
+        {"key-pre", required_argument, NULL, 'k'},
+        {"source-bytes", required_argument, NULL, 's'},
+        {"e-abs", required_argument, NULL, 'e'},
+        {"pool-bytes", required_argument, NULL, 'p'},
+        {"runs", required_argument, NULL, 'n'},
+        {"warmup", required_argument, NULL, 'w'},
+        {"seed", required_argument, NULL, 'S'},
+        {"json", no_argument, NULL, 'j'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+    struct xlock_params params;
+    struct bench_result res;
+    unsigned int a, b, c, d, e;
+    int opt, bad = 0, first = 1;
+
+    while ((opt = getopt_long(argc, argv, "L:C:k:s:e:p:n:w:S:jh", long_opts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'L':
+            bad |= bench_parse_uints(optarg, &opts.locks, UINT_MAX);
+            break;
+        case 'C':
+            bad |= bench_parse_uints(optarg, &opts.xorations, UINT_MAX);
+            break;
+        case 'k':
+            bad |= bench_parse_uints(optarg, &opts.key_pre, UINT_MAX);
+            break;
+        case 's':
+            bad |= bench_parse_uints(optarg, &opts.source_bytes, UINT_MAX / 8);
+            break;
+        case 'e':
+            bad |= bench_parse_list(optarg, &opts.e_abs);
+            break;
+        case 'p':
+            opts.pool_bytes = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            opts.runs = strtoul(optarg, NULL, 10);
+            break;
+        case 'w':
+            opts.warmup = strtoul(optarg, NULL, 10);
+            break;
+        case 'S':
+            opts.seed = strtoul(optarg, NULL, 10);
+            break;
+        case 'j':
+            opts.json = 1;
+            break;
+        default:
+            bad = 1;
+        }
+    }
+    if (bad || optind != argc || !opts.runs || !opts.pool_bytes)
+    {
+        bench_usage(argv[0]);
+        return 1;
+    }
+
+    params.pool_bits = bytes_to_bits(opts.pool_bytes);
+    params.key_bits = bytes_to_bits(BENCH_KEY_BYTES);
+    params.token_bytes = BENCH_TOKEN_BYTES;
+
+    if (opts.json)
+        printf("[");
+    for (a = 0; a < opts.locks.n; a++)
+        for (b = 0; b < opts.xorations.n; b++)
+            for (c = 0; c < opts.key_pre.n; c++)
+                for (d = 0; d < opts.source_bytes.n; d++)
+                    for (e = 0; e < opts.e_abs.n; e++)
+                    {
+                        params.n_locks = (unsigned int)opts.locks.v[a];
+                        params.n_xoration = (unsigned int)opts.xorations.v[b];
+                        params.key_pre_bits = (unsigned int)opts.key_pre.v[c];
+                        params.source_bits = bytes_to_bits((unsigned int)opts.source_bytes.v[d]);
+
+                        bench_run(&opts, &params, opts.source_bytes.v[d], opts.e_abs.v[e], &res);
+                        bench_print(&opts, &params, opts.source_bytes.v[d], opts.e_abs.v[e], &res, first);
+                        fflush(stdout);
+                        first = 0;
+                    }
+    if (opts.json)
+        printf("\n]\n");
+
+    return 0;
+}
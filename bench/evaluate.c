@@ -0,0 +1,399 @@
+/**
+ * @file evaluate.c
+ * @brief Evaluation of X-Lock on recorded source readings
+ *
+ * This program streams a dump of real source readings through enroll,
+ * gen and rep. The dump holds the readings of every device back to
+ * back, reads_per_device readings per device: the first one enrolls the
+ * device and generates its key, the others reproduce it. Reproductions
+ * of a chunk run on a worker pool while the next chunk is loaded.
+ *
+ * One CSV row reports the key failure rate together with the measured
+ * bit error rate and bias of the readings, which the i.i.d. simulator
+ * cannot account for.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <getopt.h>
+
+#include "../include/bits.h"
+#include "../include/xlock.h"
+#include "../include/context.h"
+#include "../include/batch.h"
+#include "../include/dump.h"
+#include "../include/tictoc.h"
+
+/**
+ * @brief key length in bytes
+ */
+#define EVAL_KEY_BYTES 32
+
+/**
+ * @brief robustness token length in bytes
+ */
+#define EVAL_TOKEN_BYTES 32
+
+/**
+ * @brief state of an evaluation
+ */
+struct eval
+{
+    struct xlock_params params; /**< X-Lock parameters */
+    unsigned int source_bytes;  /**< length of a reading */
+    unsigned int reads;         /**< readings per device */
+    unsigned int devices;       /**< devices per chunk */
+    unsigned char *pools;       /**< pools of the chunk */
+    unsigned char *vaults;      /**< vaults of the chunk */
+    unsigned char *tokens;      /**< tokens of the chunk */
+    struct xlock_batch gen;     /**< enrollments of the chunk */
+    struct xlock_batch batch;   /**< reproductions of the chunk */
+    unsigned int *owner;        /**< device of each reproduction */
+    uint64_t n_devices;         /**< enrolled devices */
+    uint64_t gen_failures;      /**< failed enrollments or generations */
+    uint64_t reps;              /**< reproductions */
+    uint64_t failures;          /**< failed reproductions */
+    uint64_t wrong;             /**< reproduced keys differing from gen */
+    uint64_t flips;             /**< reading bits differing from enrollment */
+    uint64_t ones;              /**< enrollment bits set to 1 */
+};
+
+/**
+ * @brief counts the bits where two readings differ
+ *
+ * @param a reading
+ * @param b reading
+ * @param size size of the readings in bytes
+ * @return the Hamming distance between a and b
+ */
+uint64_t eval_distance(unsigned char *a, unsigned char *b, unsigned int size)
+{
+    uint64_t d = 0, x, y;
+    unsigned int i;
+
+    for (i = 0; i + 8 <= size; i += 8)
+    {
+        memcpy(&x, a + i, 8);
+        memcpy(&y, b + i, 8);
+        d += popcount64(x ^ y);
+    }
+    for (; i < size; i++)
+        d += popcount64((uint64_t)(a[i] ^ b[i]));
+
+    return d;
+}
+
+/**
+ * @brief allocates the buffers of an evaluation
+ *
+ * @param ev evaluation, with params, source_bytes, reads and devices set
+ * @return 0 on success, -1 if params are invalid or memory is short
+ */
+int eval_init(struct eval *ev)
+{
+    struct xlock_params *params = &ev->params;
+    unsigned int n = ev->devices * (ev->reads - 1);
+
+    if (xlock_params_check(params))
+        return -1;
+
+    ev->pools = malloc((size_t)ev->devices * bits_to_bytes(params->pool_bits));
+    ev->vaults = malloc((size_t)ev->devices * bits_to_bytes(params->pool_bits * params->n_locks));
+    ev->tokens = malloc((size_t)ev->devices * params->token_bytes);
+    ev->gen.reads = malloc(ev->devices * sizeof(unsigned char *));
+    ev->gen.source_seeds = malloc(ev->devices * sizeof(unsigned long));
+    ev->gen.vaults = malloc(ev->devices * sizeof(unsigned char *));
+    ev->gen.key_seeds = malloc(ev->devices * sizeof(unsigned long));
+    ev->gen.nonces = malloc(ev->devices * sizeof(unsigned long));
+    ev->gen.tokens = malloc(ev->devices * sizeof(unsigned char *));
+    ev->gen.keys = malloc((size_t)ev->devices * EVAL_KEY_BYTES);
+    ev->gen.ok = malloc(ev->devices * sizeof(int));
+    ev->gen.pools = malloc(ev->devices * sizeof(unsigned char *));
+    ev->owner = malloc(n * sizeof(unsigned int));
+    ev->batch.reads = malloc(n * sizeof(unsigned char *));
+    ev->batch.source_seeds = malloc(n * sizeof(unsigned long));
+    ev->batch.vaults = malloc(n * sizeof(unsigned char *));
+    ev->batch.key_seeds = malloc(n * sizeof(unsigned long));
+    ev->batch.nonces = malloc(n * sizeof(unsigned long));
+    ev->batch.tokens = malloc(n * sizeof(unsigned char *));
+    ev->batch.keys = malloc((size_t)n * EVAL_KEY_BYTES);
+    ev->batch.ok = malloc(n * sizeof(int));
+
+    if (!ev->pools || !ev->vaults || !ev->tokens ||
+        !ev->gen.reads || !ev->gen.source_seeds || !ev->gen.vaults ||
+        !ev->gen.key_seeds || !ev->gen.nonces || !ev->gen.tokens ||
+        !ev->gen.keys || !ev->gen.ok || !ev->gen.pools || !ev->owner ||
+        !ev->batch.reads || !ev->batch.source_seeds || !ev->batch.vaults ||
+        !ev->batch.key_seeds || !ev->batch.nonces || !ev->batch.tokens ||
+        !ev->batch.keys || !ev->batch.ok)
+        return -1;
+
+    return 0;
+}
+
+/**
+ * @brief releases the buffers of an evaluation
+ *
+ * @param ev evaluation
+ * @return void
+ */
+void eval_free(struct eval *ev)
+{
+    free(ev->batch.ok);
+    free(ev->batch.keys);
+    free(ev->batch.tokens);
+    free(ev->batch.nonces);
+    free(ev->batch.key_seeds);
+    free(ev->batch.vaults);
+    free(ev->batch.source_seeds);
+    free(ev->batch.reads);
+    free(ev->owner);
+    free(ev->gen.pools);
+    free(ev->gen.ok);
+    free(ev->gen.keys);
+    free(ev->gen.tokens);
+    free(ev->gen.nonces);
+    free(ev->gen.key_seeds);
+    free(ev->gen.vaults);
+    free(ev->gen.source_seeds);
+    free(ev->gen.reads);
+    free(ev->tokens);
+    free(ev->vaults);
+    free(ev->pools);
+}
+
+/**
+ * @brief evaluates the devices of a chunk
+ *
+ * Devices are enrolled and their keys generated in a first batch, then
+ * the devices whose generation succeeded are reproduced in a second one.
+ *
+ * @param ev evaluation
+ * @param workers worker pool for the enrollments and reproductions
+ * @param reads readings of the chunk
+ * @param n_devices number of devices of the chunk
+ * @return void
+ */
+void eval_chunk(struct eval *ev, struct xlock_pool *workers, unsigned char *reads, unsigned int n_devices)
+{
+    struct xlock_params *params = &ev->params;
+    struct xlock_batch *gen = &ev->gen;
+    size_t pool_bytes = bits_to_bytes(params->pool_bits);
+    size_t vault_bytes = bits_to_bytes(params->pool_bits * params->n_locks);
+    unsigned int d, r, k, i = 0;
+    unsigned char *ref;
+
+    for (d = 0; d < n_devices; d++)
+    {
+        ref = reads + (size_t)d * ev->reads * ev->source_bytes;
+        gen->reads[d] = ref;
+        gen->pools[d] = ev->pools + d * pool_bytes;
+        gen->vaults[d] = ev->vaults + d * vault_bytes;
+        gen->tokens[d] = ev->tokens + (size_t)d * params->token_bytes;
+
+        /* seeds of 0 are initialized by enroll and gen */
+        gen->source_seeds[d] = 0;
+        gen->key_seeds[d] = 0;
+        gen->nonces[d] = 0;
+        init_random(gen->pools[d], pool_bytes);
+        for (k = 0; k < ev->source_bytes; k++)
+            ev->ones += popcount64((uint64_t)ref[k]);
+    }
+
+    gen->n = n_devices;
+    ev->gen_failures += n_devices - xlock_pool_gen(workers, gen);
+    ev->n_devices += n_devices;
+
+    /* readings are reproduced in place, for the generated devices only */
+    for (d = 0; d < n_devices; d++)
+    {
+        if (!gen->ok[d])
+            continue;
+        ref = gen->reads[d];
+        for (r = 1; r < ev->reads; r++, i++)
+        {
+            ev->batch.reads[i] = ref + (size_t)r * ev->source_bytes;
+            ev->batch.source_seeds[i] = gen->source_seeds[d];
+            ev->batch.vaults[i] = gen->vaults[d];
+            ev->batch.key_seeds[i] = gen->key_seeds[d];
+            ev->batch.nonces[i] = gen->nonces[d];
+            ev->batch.tokens[i] = gen->tokens[d];
+            ev->owner[i] = d;
+            ev->flips += eval_distance(ref, ev->batch.reads[i], ev->source_bytes);
+        }
+    }
+
+    ev->batch.n = i;
+    ev->reps += i;
+    ev->failures += i - xlock_pool_rep(workers, &ev->batch);
+
+    for (k = 0; k < i; k++)
+    {
+        d = ev->owner[k];
+        if (ev->batch.ok[k] && memcmp(ev->batch.keys + (size_t)k * EVAL_KEY_BYTES, gen->keys + (size_t)d * EVAL_KEY_BYTES, EVAL_KEY_BYTES))
+            ev->wrong++;
+    }
+}
+
+/**
+ * @brief prints the usage of the evaluator
+ *
+ * @param name program name
+ * @return void
+ */
+void eval_usage(char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options] DUMP\n"
+            "  -r, --reads N             readings per device (2)\n"
+            "  -s, --source-bytes N      length of a reading in bytes (8004)\n"
+            "  -o, --offset N            offset of the first reading (0)\n"
+            "  -L, --locks N             n_locks (64)\n"
+            "  -C, --xorations N         n_xoration (2)\n"
+            "  -k, --key-pre N           key_pre_bits (80)\n"
+            "  -p, --pool-bytes N        pool length in bytes (32)\n"
+            "  -c, --chunk N             devices per chunk (256)\n"
+            "  -t, --threads N           worker threads, 0 for one per CPU (0)\n"
+            "  -S, --seed N              seed of pools and seeds (1)\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    struct eval ev;
+    struct xlock_dump dump;
+    struct xlock_pool workers;
+    unsigned int n_threads = 0, pool_bytes = 32, n;
+    unsigned long seed = 1;
+    uint64_t offset = 0;
+    unsigned char *reads;
+    struct timespec start, end;
+    double ms;
+    struct option long_opts[] = {
+        {"reads", required_argument, NULL, 'r'},
+        {"source-bytes", required_argument, NULL, 's'},
+        {"offset", required_argument, NULL, 'o'},
+        {"locks", required_argument, NULL, 'L'},
+        {"xorations", required_argument, NULL, 'C'},
+        {"key-pre", required_argument, NULL, 'k'},
+        {"pool-bytes", required_argument, NULL, 'p'},
+        {"chunk", required_argument, NULL, 'c'},
+        {"threads", required_argument, NULL, 't'},
+        {"seed", required_argument, NULL, 'S'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+    int opt, bad = 0, ret = 1;
+
+    memset(&ev, 0, sizeof(ev));
+    ev.params.n_locks = 64;
+    ev.params.n_xoration = 2;
+    ev.params.key_pre_bits = 80;
+    ev.source_bytes = 8004;
+    ev.reads = 2;
+    ev.devices = 256;
+
+    while ((opt = getopt_long(argc, argv, "r:s:o:L:C:k:p:c:t:S:h", long_opts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'r':
+            ev.reads = strtoul(optarg, NULL, 10);
+            break;
+        case 's':
+            ev.source_bytes = strtoul(optarg, NULL, 10);
+            break;
+        case 'o':
+            offset = strtoull(optarg, NULL, 10);
+            break;
+        case 'L':
+            ev.params.n_locks = strtoul(optarg, NULL, 10);
+            break;
+        case 'C':
+            ev.params.n_xoration = strtoul(optarg, NULL, 10);
+            break;
+        case 'k':
+            ev.params.key_pre_bits = strtoul(optarg, NULL, 10);
+            break;
+        case 'p':
+            pool_bytes = strtoul(optarg, NULL, 10);
+            break;
+        case 'c':
+            ev.devices = strtoul(optarg, NULL, 10);
+            break;
+        case 't':
+            n_threads = strtoul(optarg, NULL, 10);
+            break;
+        case 'S':
+            seed = strtoul(optarg, NULL, 10);
+            break;
+        default:
+            bad = 1;
+        }
+    }
+    if (bad || optind != argc - 1 || ev.reads < 2 || !ev.source_bytes || !ev.devices || !pool_bytes)
+    {
+        eval_usage(argv[0]);
+        return 1;
+    }
+
+    ev.params.source_bits = bytes_to_bits(ev.source_bytes);
+    ev.params.pool_bits = bytes_to_bits(pool_bytes);
+    ev.params.key_bits = bytes_to_bits(EVAL_KEY_BYTES);
+    ev.params.token_bytes = EVAL_TOKEN_BYTES;
+    srand(seed);
+
+    if (eval_init(&ev))
+    {
+        fprintf(stderr, "%s: invalid parameters or out of memory\n", argv[0]);
+        goto out;
+    }
+    if (xlock_pool_init(&workers, &ev.params, n_threads))
+    {
+        fprintf(stderr, "%s: cannot start the workers\n", argv[0]);
+        goto out;
+    }
+    if (xlock_dump_open(&dump, argv[optind], offset, ev.source_bytes, ev.devices * ev.reads))
+    {
+        fprintf(stderr, "%s: cannot open %s\n", argv[0], argv[optind]);
+        goto out_workers;
+    }
+
+    TIC(start);
+    while ((n = xlock_dump_next(&dump, &reads)))
+        eval_chunk(&ev, &workers, reads, n / ev.reads);
+    TOC(end);
+    ms = TIC_TOC(start, end);
+
+    if (dump.error)
+    {
+        fprintf(stderr, "%s: cannot read %s\n", argv[0], argv[optind]);
+    }
+    else
+    {
+        if (dump.n_reads % ev.reads)
+            fprintf(stderr, "%s: ignoring %llu trailing readings\n", argv[0],
+                    (unsigned long long)(dump.n_reads % ev.reads));
+
+        printf("devices,gen_failures,reps,failures,wrong_keys,p,bit_error_rate,ones,bytes,seconds,mb_per_s\n");
+        printf("%llu,%llu,%llu,%llu,%llu,%g,%g,%g,%llu,%g,%g\n",
+               (unsigned long long)ev.n_devices, (unsigned long long)ev.gen_failures,
+               (unsigned long long)ev.reps,
+               (unsigned long long)ev.failures, (unsigned long long)ev.wrong,
+               ev.reps ? (double)ev.failures / ev.reps : 0,
+               ev.reps ? (double)ev.flips / ((double)ev.reps * ev.params.source_bits) : 0,
+               ev.n_devices ? (double)ev.ones / ((double)ev.n_devices * ev.params.source_bits) : 0,
+               (unsigned long long)(dump.n_reads * ev.source_bytes), ms / 1000,
+               ms ? dump.n_reads * ev.source_bytes / (ms * 1000) : 0);
+        ret = 0;
+    }
+
+    xlock_dump_close(&dump);
+out_workers:
+    xlock_pool_free(&workers);
+out:
+    eval_free(&ev);
+    return ret;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file simulate.c
+ * @brief Key failure probability simulator of X-Lock
+ *
+ * This program estimates the key failure probability of every
+ * combination of the given parameter lists with xlock_sim_run(), and
+ * prints one CSV row per configuration with its confidence interval.
+ * With --sliced, trials run 64 at a time through xlock_sim_run64().
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <limits.h>
+#include <getopt.h>
+
+#include "../include/bits.h"
+#include "../include/context.h"
+#include "../include/sim.h"
+
+/**
+ * @brief maximum length of a parameter list
+ */
+#define SIM_LIST 32
+
+/**
+ * @brief key length in bytes
+ */
+#define SIM_KEY_BYTES 32
+
+/**
+ * @brief robustness token length in bytes
+ */
+#define SIM_TOKEN_BYTES 32
+
+/**
+ * @brief list of values of a swept parameter
+ */
+struct sim_list
+{
+    unsigned int n;     /**< number of values */
+    double v[SIM_LIST]; /**< values */
+};
+
+/**
+ * @brief parses a comma-separated list of numbers
+ *
+ * @param s list
+ * @param list storage for the values
+ * @return 0 on success, -1 if s is not a list of numbers
+ */
+int sim_parse_list(char *s, struct sim_list *list)
+{
+    char *end;
+
+    list->n = 0;
+    while (*s)
+    {
+        if (list->n == SIM_LIST)
+            return -1;
+        list->v[list->n++] = strtod(s, &end);
+        if (end == s || (*end && *end != ','))
+            return -1;
+        s = *end ? end + 1 : end;
+    }
+
+    return list->n ? 0 : -1;
+}
+
+/**
+ * @brief parses a comma-separated list of positive integers
+ *
+ * @param s list
+ * @param list storage for the values
+ * @param max largest value accepted
+ * @return 0 on success, -1 if s is not a list of integers in [1, max]
+ */
+int sim_parse_uints(char *s, struct sim_list *list, unsigned int max)
+{
+    unsigned int i;
+
+    if (sim_parse_list(s, list))
+        return -1;
+
+    /* the range is checked first, casting is undefined out of it, NaN included */
+    for (i = 0; i < list->n; i++)
+    {
+        if (!(list->v[i] >= 1 && list->v[i] <= max) || list->v[i] != (unsigned int)list->v[i])
+            return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief prints the usage of the simulator
+ *
+ * @param name program name
+ * @return void
+ */
+void sim_usage(char *name)
+{
+    fprintf(stderr,
+            "usage: %s [options]\n"
+            "  -L, --locks LIST          n_locks values (64)\n"
+            "  -C, --xorations LIST      n_xoration values (2)\n"
+            "  -k, --key-pre LIST        key_pre_bits values (80)\n"
+            "  -s, --source-bytes LIST   source_bytes values (8004)\n"
+            "  -e, --e-abs LIST          e_abs values (0.15)\n"
+            "  -p, --pool-bytes N        pool length in bytes (32)\n"
+            "  -n, --trials N            trials per configuration (1000000)\n"
+            "  -t, --threads N           threads, 0 for one per CPU (0)\n"
+            "  -S, --seed N              base seed (1)\n"
+            "  -z, --z Z                 normal quantile of the interval (1.96)\n"
+            "  -b, --sliced              run 64 trials at a time\n"
+            "LIST is a comma-separated list of values, integers but for e_abs.\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    struct sim_list locks = {1, {64}}, xorations = {1, {2}}, key_pre = {1, {80}};
+    struct sim_list source_bytes = {1, {8004}}, e_abs = {1, {0.15}};
+    unsigned int pool_bytes = 32, n_threads = 0;
+    uint64_t trials = 1000000, seed = 1;
+    double z = 1.96;
+    int sliced = 0;
+    struct option long_opts[] = {
+        {"locks", required_argument, NULL, 'L'},
+        {"xorations", required_argument, NULL, 'C'},
+        {"key-pre", required_argument, NULL, 'k'},
+        {"source-bytes", required_argument, NULL, 's'},
+        {"e-abs", required_argument, NULL, 'e'},
+        {"pool-bytes", required_argument, NULL, 'p'},
+        {"trials", required_argument, NULL, 'n'},
+        {"threads", required_argument, NULL, 't'},
+        {"seed", required_argument, NULL, 'S'},
+        {"z", required_argument, NULL, 'z'},
+        {"sliced", no_argument, NULL, 'b'},
+        {"help", no_argument, NULL, 'h'},
+        {NULL, 0, NULL, 0}};
+    struct xlock_params params;
+    struct xlock_sim_result res;
+    unsigned int a, b, c, d, e;
+    int opt, bad = 0;
+
+    while ((opt = getopt_long(argc, argv, "L:C:k:s:e:p:n:t:S:z:bh", long_opts, NULL)) != -1)
+    {
+        switch (opt)
+        {
+        case 'L':
+            bad |= sim_parse_uints(optarg, &locks, UINT_MAX);
+            break;
+        case 'C':
+            bad |= sim_parse_uints(optarg, &xorations, UINT_MAX);
+            break;
+        case 'k':
+            bad |= sim_parse_uints(optarg, &key_pre, UINT_MAX);
+            break;
+        case 's':
+            bad |= sim_parse_uints(optarg, &source_bytes, UINT_MAX / 8);
+            break;
+        case 'e':
+            bad |= sim_parse_list(optarg, &e_abs);
+            break;
+        case 'p':
+            pool_bytes = strtoul(optarg, NULL, 10);
+            break;
+        case 'n':
+            trials = strtoull(optarg, NULL, 10);
+            break;
+        case 't':
+            n_threads = strtoul(optarg, NULL, 10);
+            break;
+        case 'S':
+            seed = strtoull(optarg, NULL, 10);
+            break;
+        case 'z':
+            z = strtod(optarg, NULL);
+            break;
+        case 'b':
+            sliced = 1;
+            break;
+        default:
+            bad = 1;
+        }
+    }
+    if (bad || optind != argc || !trials || !pool_bytes)
+    {
+        sim_usage(argv[0]);
+        return 1;
+    }
+
+    params.pool_bits = bytes_to_bits(pool_bytes);
+    params.key_bits = bytes_to_bits(SIM_KEY_BYTES);
+    params.token_bytes = SIM_TOKEN_BYTES;
+
+    printf("n_locks,n_xoration,key_pre_bits,source_bytes,e_abs,trials,failures,bit_errors,p,p_lo,p_hi,error\n");
+    for (a = 0; a < locks.n; a++)
+        for (b = 0; b < xorations.n; b++)
+            for (c = 0; c < key_pre.n; c++)
+                for (d = 0; d < source_bytes.n; d++)
+                    for (e = 0; e < e_abs.n; e++)
+                    {
+                        params.n_locks = (unsigned int)locks.v[a];
+                        params.n_xoration = (unsigned int)xorations.v[b];
+                        params.key_pre_bits = (unsigned int)key_pre.v[c];
+                        params.source_bits = bytes_to_bits((unsigned int)source_bytes.v[d]);
+
+                        printf("%u,%u,%u,%u,%g,%llu", params.n_locks, params.n_xoration,
+                               params.key_pre_bits, (unsigned int)source_bytes.v[d], e_abs.v[e],
+                               (unsigned long long)trials);
+                        if (xlock_params_check(&params))
+                            printf(",,,,,,invalid parameters\n");
+                        else if ((sliced ? xlock_sim_run64 : xlock_sim_run)(&params, e_abs.v[e], trials, n_threads, seed, z, &res))
+                            printf(",,,,,,simulation failed\n");
+                        else
+                            printf(",%llu,%llu,%g,%g,%g,\n", (unsigned long long)res.failures,
+                                   (unsigned long long)res.bits, res.p, res.lo, res.hi);
+                        fflush(stdout);
+                    }
+
+    return 0;
+}
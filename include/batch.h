@@ -0,0 +1,124 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+/**
+ * @file batch.h
+ * @brief Batch reproduction across a worker pool
+ *
+ * This file exposes a pool of worker threads that reproduce the keys of
+ * many devices in one call. Every worker owns an X-Lock context and its
+ * scratch memory, so a batch neither allocates nor shares state between
+ * workers.
+ */
+
+#include <pthread.h>
+
+#include "context.h"
+
+/**
+ * @brief devices reproduced by one batch
+ *
+ * Entry i of every array refers to the same device. Keys are stored
+ * back to back, bits_to_bytes(key_bits) bytes each.
+ */
+struct xlock_batch
+{
+    unsigned int n;              /**< number of devices */
+    unsigned char **reads;       /**< readings from the sources */
+    unsigned long *source_seeds; /**< source seeds */
+    unsigned char **vaults;      /**< encrypted vaults */
+    unsigned long *key_seeds;    /**< key seeds */
+    unsigned long *nonces;       /**< nonces for final key generation */
+    unsigned char **tokens;      /**< robustness tokens */
+    unsigned char *keys;         /**< n keys storage */
+    int *ok;                     /**< n flags, 1 if the key was reproduced */
+    unsigned char **pools;       /**< random pools, read by xlock_pool_gen() */
+};
+
+struct xlock_pool;
+
+/**
+ * @brief worker of a pool
+ */
+struct xlock_worker
+{
+    struct xlock_pool *pool; /**< owning pool */
+    struct xlock_ctx ctx;    /**< context of the worker */
+    pthread_t thread;        /**< thread of the worker */
+};
+
+/**
+ * @brief pool of workers reproducing batches
+ *
+ * Batches submitted to the same pool from several threads are served
+ * one after the other.
+ */
+struct xlock_pool
+{
+    struct xlock_params params;   /**< parameters of the batches */
+    unsigned int n_workers;       /**< number of workers */
+    struct xlock_worker *workers; /**< n_workers workers */
+    unsigned char *scratch;       /**< scratch memory of the workers */
+    pthread_mutex_t submit;       /**< serializes batches */
+    pthread_mutex_t lock;         /**< protects the fields below */
+    pthread_cond_t work;          /**< signals a new batch or stop */
+    pthread_cond_t done;          /**< signals the end of a batch */
+    struct xlock_batch *batch;    /**< batch in progress */
+    int gen;                      /**< the batch enrolls and generates */
+    unsigned long round;          /**< number of submitted batches */
+    unsigned int active;          /**< workers still on the batch */
+    unsigned int next;            /**< next device to reproduce */
+    int stop;                     /**< workers must exit */
+};
+
+/**
+ * @brief starts a pool of workers
+ *
+ * @param pool pool
+ * @param params X-Lock parameters
+ * @param n_workers number of workers, 0 for one per online CPU
+ * @return 0 on success, -1 if params are invalid or the workers could
+ * not be started
+ */
+int xlock_pool_init(struct xlock_pool *pool, struct xlock_params *params, unsigned int n_workers);
+
+/**
+ * @brief reproduces the keys of a batch of devices
+ *
+ * Devices are handed out to the workers one at a time, so a slow
+ * device does not stall the others. The function returns once every
+ * device of the batch was processed.
+ *
+ * @param pool pool
+ * @param batch devices to reproduce
+ * @return the number of reproduced keys
+ * @note on failure, the key of a device is nullified and its flag is 0.
+ * @note if seeds are 0, they are initialized as rep does.
+ */
+unsigned int xlock_pool_rep(struct xlock_pool *pool, struct xlock_batch *batch);
+
+/**
+ * @brief enrolls a batch of devices and generates their keys
+ *
+ * Entry i of the batch enrolls reads[i] as the preferred source state,
+ * locking pools[i] into vaults[i], then generates keys, seeds, nonces
+ * and tokens from reads[i]. Devices are handed out to the workers as
+ * xlock_pool_rep() does.
+ *
+ * @param pool pool
+ * @param batch devices to enroll, with pools set
+ * @return the number of generated keys
+ * @note on failure, the flag of a device is 0.
+ * @note if seeds are 0, they are initialized as gen does.
+ */
+unsigned int xlock_pool_gen(struct xlock_pool *pool, struct xlock_batch *batch);
+
+/**
+ * @brief stops the workers and releases a pool
+ *
+ * @param pool pool
+ * @return void
+ */
+void xlock_pool_free(struct xlock_pool *pool);
+
+#endif
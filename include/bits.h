@@ -48,6 +48,11 @@
  */
 #define is_power_of_two(n) n &(n - 1) == 0 and n != 0
 
+/**
+ * @brief Returns the number of bits set in the 64-bit word n.
+ */
+#define popcount64(n) __builtin_popcountll(n)
+
 /**
  * @brief Returns the value of bit in arr.
  */
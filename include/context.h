@@ -0,0 +1,361 @@
+#ifndef CONTEXT_H
+#define CONTEXT_H
+
+/**
+ * @file context.h
+ * @brief Reusable X-Lock contexts
+ *
+ * This file exposes a context API for X-Lock. A context validates the
+ * parameters once and keeps the scratch memory of gen and rep in a
+ * caller-supplied buffer, so that repeated calls neither grow the
+ * stack nor allocate.
+ */
+
+#include <stddef.h>
+
+struct plan_cache;
+struct xlock_stable;
+
+/**
+ * @brief X-Lock parameters
+ */
+struct xlock_params
+{
+    unsigned int source_bits;  /**< source length in bits */
+    unsigned int pool_bits;    /**< pool length in bits */
+    unsigned int key_bits;     /**< key length in bits */
+    unsigned int key_pre_bits; /**< key_pre length in bits */
+    unsigned int token_bytes;  /**< robustness token length in bytes */
+    unsigned int n_locks;      /**< number of locks per bit-locker */
+    unsigned int n_xoration;   /**< number of bits per XOR-ation */
+};
+
+/**
+ * @brief X-Lock context
+ *
+ * The scratch pointers refer to the buffer passed to xlock_ctx_init(),
+ * which must outlive the context. Indexes are stored in index_bytes
+ * each, as given by xlock_index_bytes(). A context must not be used by
+ * more than one thread at a time.
+ */
+struct xlock_ctx
+{
+    struct xlock_params params;   /**< validated parameters */
+    unsigned int index_bytes;     /**< width of the stored indexes */
+    void *source_indexes;         /**< key_pre_bits * n_locks * n_xoration */
+    void *key_indexes;            /**< key_pre_bits */
+    unsigned char *pool;          /**< bits_to_bytes(pool_bits), unlocked pool */
+    unsigned char *needed;        /**< bits_to_bytes(pool_bits), needed lockers */
+    unsigned char *key_pre;       /**< bits_to_bytes(key_pre_bits) */
+    unsigned char *token;         /**< token_bytes */
+    struct plan_cache *plans;     /**< optional unlock plan cache */
+    int early_exit;               /**< stop votes once settled */
+    unsigned char *e_map;         /**< optional error map for soft votes */
+    struct xlock_stable *stable;  /**< optional stable bits to draw from */
+    unsigned long lockers;        /**< bit-lockers unlocked with early exit */
+    unsigned long locks_skipped;  /**< locks skipped by early exit */
+};
+
+/**
+ * @brief returns the width of the indexes of a parameter set
+ *
+ * Indexes are stored in 16 bits when source_bits is at most
+ * INDEX16_BITS, in 32 bits otherwise.
+ *
+ * @param params X-Lock parameters
+ * @return the size in bytes of a stored index
+ */
+unsigned int xlock_index_bytes(struct xlock_params *params);
+
+/**
+ * @brief returns the ith stored index
+ *
+ * @param index_bytes width of the stored indexes
+ * @param indexes stored indexes
+ * @param i position of the index
+ * @return the ith index
+ */
+unsigned int xlock_index_get(unsigned int index_bytes, void *indexes, unsigned int i);
+
+/**
+ * @brief derives the indexes of the bit-lockers forming key_pre
+ *
+ * This function produces the key_pre_bits key indexes and the source
+ * indexes of the bit-lockers they select, as unlock() expects them.
+ * Indexes are stored in xlock_index_bytes(params) bytes each.
+ *
+ * @param params X-Lock parameters
+ * @param source_seed source seed for indexes to unlock vault
+ * @param key_seed key seed for indexes that form the key
+ * @param key_indexes storage for key_pre_bits indexes
+ * @param source_indexes storage for key_pre_bits * n_locks * n_xoration
+ * indexes
+ * @return void
+ * @note if seeds are not specified or are 0, they are initialized.
+ */
+void xlock_indexes(
+    struct xlock_params *params,
+    unsigned long *source_seed,
+    unsigned long *key_seed,
+    void *key_indexes,
+    void *source_indexes);
+
+/**
+ * @brief validates a parameter set
+ *
+ * @param params X-Lock parameters
+ * @return 0 if params are valid, -1 otherwise
+ */
+int xlock_params_check(struct xlock_params *params);
+
+/**
+ * @brief returns the scratch size of a context
+ *
+ * @param params X-Lock parameters, validated by xlock_params_check()
+ * @return the size in bytes of the buffer needed by xlock_ctx_init()
+ */
+size_t xlock_ctx_size(struct xlock_params *params);
+
+/**
+ * @brief initializes a context
+ *
+ * This function validates params and lays out the scratch memory of
+ * the context in buf. No memory is allocated.
+ *
+ * @param ctx context
+ * @param params X-Lock parameters
+ * @param buf scratch buffer
+ * @param size size of buf in bytes, at least xlock_ctx_size(params)
+ * @return 0 on success, -1 if params are invalid or buf is too small
+ */
+int xlock_ctx_init(struct xlock_ctx *ctx, struct xlock_params *params, void *buf, size_t size);
+
+/**
+ * @brief attaches an unlock plan cache to a context
+ *
+ * Once attached, gen and rep look up the indexes of every non-zero
+ * (source_seed, key_seed) pair in cache before deriving them.
+ *
+ * @param ctx context
+ * @param cache plan cache, NULL to detach
+ * @return 0 on success, -1 if cache was built for other parameters
+ * @see plan_cache_init
+ */
+int xlock_ctx_set_plan_cache(struct xlock_ctx *ctx, struct plan_cache *cache);
+
+/**
+ * @brief enables or disables early-exit voting
+ *
+ * With early exit, gen and rep unlock through unlock_early() and the
+ * context accumulates the number of unlocked bit-lockers and of skipped
+ * locks.
+ *
+ * @param ctx context
+ * @param enable 0 to disable, otherwise enable
+ * @return void
+ * @see unlock_early
+ */
+void xlock_ctx_set_early_exit(struct xlock_ctx *ctx, int enable);
+
+/**
+ * @brief enables or disables soft-decision voting
+ *
+ * With an error map, gen and rep unlock through unlock_soft(), which
+ * takes precedence over early exit. The map must outlive its use by the
+ * context.
+ *
+ * @param ctx context
+ * @param e_map error probability of every source bit, in 1/256, or
+ * NULL to vote hard again
+ * @return void
+ * @see unlock_soft
+ * @see reliability_map
+ */
+void xlock_ctx_set_reliability(struct xlock_ctx *ctx, unsigned char *e_map);
+
+/**
+ * @brief restricts source indexes to the stable bits
+ *
+ * Once set, enrollment, gen and rep draw source indexes as ranks among
+ * the stable bits and map them to source positions with select, so
+ * that unstable bits never enter a bit-locker. The same stable bits
+ * must be set at enrollment and at reproduction. Plan caches hold
+ * unrestricted indexes, so they are bypassed meanwhile. The structure
+ * must outlive its use by the context.
+ *
+ * @param ctx context
+ * @param stable rank/select structure over the stable bits, or NULL to
+ * draw from every source bit again
+ * @return 0 on success, -1 if stable covers another source length,
+ * holds fewer than pool_bits * n_locks * n_xoration stable bits, or
+ * spans more than XLOCK_STABLE_SPAN words between samples
+ * @see xlock_stable_init
+ */
+int xlock_ctx_set_stable(struct xlock_ctx *ctx, struct xlock_stable *stable);
+
+/**
+ * @brief returns the mean number of locks skipped per bit-locker
+ *
+ * @param ctx context
+ * @return the mean number of skipped locks since the context was
+ * initialized, 0 if no bit-locker was unlocked with early exit
+ */
+double xlock_ctx_mean_skipped(struct xlock_ctx *ctx);
+
+/**
+ * @brief builds the vault of a given source and pool
+ *
+ * @param ctx context
+ * @param source preferred source state
+ * @param source_seed source seed for indexes to unlock vault
+ * @param pool random pool
+ * @param vault encrypted vault
+ * @return 0
+ * @see enroll
+ * @note if source_seed is not specified or is 0, it is initialized.
+ */
+int xlock_ctx_enroll(
+    struct xlock_ctx *ctx,
+    unsigned char *source,
+    unsigned long *source_seed,
+    unsigned char *pool,
+    unsigned char *vault);
+
+/**
+ * @brief counts the key_pre bits a reading fails to reproduce
+ *
+ * This function retrieves key_pre from the vault as rep does, then
+ * compares it with the pool bits it was locked from. It skips the
+ * final key and token derivation, so it is cheaper than rep when only
+ * the reproduction outcome matters.
+ *
+ * @param ctx context
+ * @param read reading from source
+ * @param source_seed source seed for indexes to unlock vault
+ * @param vault encrypted vault
+ * @param key_seed key seed for indexes that form the key
+ * @param pool random pool locked in vault
+ * @return the number of wrong key_pre bits
+ * @note if seeds are not specified or are 0, they are initialized.
+ */
+unsigned int xlock_ctx_key_pre_errors(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned long *key_seed,
+    unsigned char *pool);
+
+/**
+ * @brief gen procedure of the fuzzy extractor
+ *
+ * @param ctx context
+ * @param read reading from source
+ * @param source_seed source seed for indexes to unlock vault
+ * @param vault encrypted vault
+ * @param key key storage
+ * @param key_seed key seed for indexes that form the key
+ * @param nonce nonce for final key generation
+ * @param token robustness token
+ * @return 0 on success, -1 if no nonce could be generated
+ * @see gen
+ * @note if seeds are not specified or are 0, they are initialized.
+ */
+int xlock_ctx_gen(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned char *key,
+    unsigned long *key_seed,
+    unsigned long *nonce,
+    unsigned char *token);
+
+/**
+ * @brief rep procedure of the fuzzy extractor
+ *
+ * @param ctx context
+ * @param read reading from source
+ * @param source_seed source seed for indexes to unlock vault
+ * @param vault encrypted vault
+ * @param key key storage
+ * @param key_seed key seed for indexes that form the key
+ * @param nonce nonce for final key generation
+ * @param token robustness token
+ * @return 0 if the key was reproduced, -1 otherwise
+ * @see rep
+ * @note on failure, key is nullified.
+ */
+int xlock_ctx_rep(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned char *key,
+    unsigned long *key_seed,
+    unsigned long *nonce,
+    unsigned char *token);
+
+/**
+ * @brief gen procedure of the fuzzy extractor for several keys
+ *
+ * This function unlocks the union of the bit-lockers selected by the
+ * key seeds once, then derives every key and token from it. Keys and
+ * tokens are stored back to back, bits_to_bytes(key_bits) and
+ * token_bytes bytes each.
+ *
+ * @param ctx context
+ * @param read reading from source
+ * @param source_seed source seed for indexes to unlock vault
+ * @param vault encrypted vault
+ * @param n_keys number of keys
+ * @param keys n_keys keys storage
+ * @param key_seeds n_keys key seeds
+ * @param nonces n_keys nonces for final key generation
+ * @param tokens n_keys robustness tokens storage
+ * @return 0 on success, -1 if no nonce could be generated
+ * @note if seeds are not specified or are 0, they are initialized.
+ * Key seeds initialized within one call are equal, so distinct keys
+ * need distinct non-zero seeds.
+ */
+int xlock_ctx_gen_multi(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned int n_keys,
+    unsigned char *keys,
+    unsigned long *key_seeds,
+    unsigned long *nonces,
+    unsigned char *tokens);
+
+/**
+ * @brief rep procedure of the fuzzy extractor for several keys
+ *
+ * @param ctx context
+ * @param read reading from source
+ * @param source_seed source seed for indexes to unlock vault
+ * @param vault encrypted vault
+ * @param n_keys number of keys
+ * @param keys n_keys keys storage
+ * @param key_seeds n_keys key seeds
+ * @param nonces n_keys nonces for final key generation
+ * @param tokens n_keys robustness tokens
+ * @param ok n_keys flags, 1 if the key was reproduced, or NULL
+ * @return 0 if every key was reproduced, -1 otherwise
+ * @see xlock_ctx_gen_multi
+ * @note on failure, the failed keys are nullified.
+ */
+int xlock_ctx_rep_multi(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned int n_keys,
+    unsigned char *keys,
+    unsigned long *key_seeds,
+    unsigned long *nonces,
+    unsigned char *tokens,
+    int *ok);
+
+#endif
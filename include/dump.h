@@ -0,0 +1,87 @@
+#ifndef DUMP_H
+#define DUMP_H
+
+/**
+ * @file dump.h
+ * @brief Streaming reader of recorded source readings
+ *
+ * This file exposes a reader of binary dumps of source readings, such as
+ * SRAM power-up states, stored back to back with a fixed length. A
+ * thread of the reader loads the next chunk of the file while the
+ * caller processes the current one, so that the caller only waits when
+ * the disk is slower than its processing.
+ *
+ * Chunks are handed out in place: a chunk stays valid until the next
+ * call to xlock_dump_next().
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+#include <pthread.h>
+
+/**
+ * @brief streaming reader of a dump
+ */
+struct xlock_dump
+{
+    int fd;                   /**< file descriptor */
+    size_t read_bytes;        /**< length of a reading */
+    uint64_t offset;          /**< offset of the first reading */
+    uint64_t n_reads;         /**< number of whole readings in the file */
+    unsigned int chunk_reads; /**< readings per chunk */
+    unsigned char *buf[2];    /**< chunk buffers */
+    unsigned int filled[2];   /**< readings in each buffer */
+    int ready[2];             /**< the buffer holds a chunk not yet released */
+    unsigned int cur;         /**< buffer held by the caller */
+    int held;                 /**< the caller holds buffer cur */
+    uint64_t next;            /**< next reading to load */
+    pthread_t thread;         /**< loading thread */
+    pthread_mutex_t lock;     /**< protects the fields above */
+    pthread_cond_t cond;      /**< signals a loaded or released buffer */
+    int stop;                 /**< the loading thread must exit */
+    int error;                /**< a read failed */
+};
+
+/**
+ * @brief opens a dump and starts loading it
+ *
+ * Trailing bytes that do not form a whole reading are ignored.
+ *
+ * @param dump reader
+ * @param path file path
+ * @param offset offset of the first reading, to skip a file header
+ * @param read_bytes length of a reading in bytes
+ * @param chunk_reads readings per chunk
+ * @return 0 on success, -1 if the file cannot be opened or memory is
+ * short
+ */
+int xlock_dump_open(
+    struct xlock_dump *dump,
+    const char *path,
+    uint64_t offset,
+    size_t read_bytes,
+    unsigned int chunk_reads);
+
+/**
+ * @brief returns the next chunk of readings
+ *
+ * The previous chunk is released and its buffer refilled in the
+ * background.
+ *
+ * @param dump reader
+ * @param reads storage for the first reading of the chunk
+ * @return the number of readings of the chunk, 0 at the end of the file
+ * or if a read failed
+ * @note dump->error tells a failed read from the end of the file.
+ */
+unsigned int xlock_dump_next(struct xlock_dump *dump, unsigned char **reads);
+
+/**
+ * @brief stops loading and closes a dump
+ *
+ * @param dump reader
+ * @return void
+ */
+void xlock_dump_close(struct xlock_dump *dump);
+
+#endif
@@ -0,0 +1,142 @@
+#ifndef GATHER_H
+#define GATHER_H
+
+/**
+ * @file gather.h
+ * @brief Source-bit gather kernels
+ *
+ * This file exposes the kernels that gather and XOR the source bits
+ * of a run of locks, and their runtime selection.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief defined when the SIMD gather kernels are built
+ */
+#if !defined(_NO_SIMD_) && defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define GATHER_X86
+#endif
+
+/**
+ * @brief kernel computing the XOR-ed source bits of a run of locks
+ *
+ * A kernel XORs the n_xoration source bits of each of n consecutive
+ * locks of a bit-locker and packs the results in a word, the jth lock
+ * in the jth bit.
+ *
+ * @param source array of bits
+ * @param source_indexes source indexes of the first lock
+ * @param n number of locks, at most 64
+ * @param n_xoration number of bits per XOR-ation
+ * @return the XOR-ed source bits of the n locks
+ */
+typedef uint64_t (*gather_fn)(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration);
+
+/**
+ * @brief kernel computing the XOR-ed source bits of a run of locks,
+ * with 16-bit source indexes
+ *
+ * @see gather_fn
+ */
+typedef uint64_t (*gather16_fn)(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration);
+
+/**
+ * @brief portable gather kernel
+ *
+ * @see gather_fn
+ */
+uint64_t gather_scalar(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration);
+
+/**
+ * @brief portable gather kernel, 16-bit source indexes
+ *
+ * @see gather16_fn
+ */
+uint64_t gather16_scalar(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration);
+
+/**
+ * @brief AVX2 gather kernel, 8 locks per gather
+ *
+ * @see gather_fn
+ * @note source must span at least 4 bytes.
+ */
+uint64_t gather_avx2(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration);
+
+/**
+ * @brief AVX2 gather kernel, 8 locks per gather, 16-bit source indexes
+ *
+ * @see gather16_fn
+ * @note source must span at least 4 bytes.
+ */
+uint64_t gather16_avx2(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration);
+
+/**
+ * @brief AVX-512 gather kernel, 16 locks per gather
+ *
+ * @see gather_fn
+ * @note source must span at least 4 bytes.
+ */
+uint64_t gather_avx512(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration);
+
+/**
+ * @brief AVX-512 gather kernel, 16 locks per gather, 16-bit source indexes
+ *
+ * @see gather16_fn
+ * @note source must span at least 4 bytes.
+ */
+uint64_t gather16_avx512(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration);
+
+/**
+ * @brief selects the gather kernel for the running CPU
+ *
+ * This function checks the CPU features through CPUID and returns
+ * the AVX-512 kernel, the AVX2 kernel or the portable one, in order
+ * of preference.
+ *
+ * @return the fastest supported gather kernel
+ * @note defining _NO_SIMD_ always selects the portable kernel.
+ */
+gather_fn gather_select(void);
+
+/**
+ * @brief selects the 16-bit index gather kernel for the running CPU
+ *
+ * @return the fastest supported gather kernel
+ * @see gather_select
+ */
+gather16_fn gather16_select(void);
+
+#endif
@@ -0,0 +1,42 @@
+#ifndef HMAC_H
+#define HMAC_H
+
+/**
+ * @file hmac.h
+ * @brief HMAC-SHA256 and random bytes for X-Lock
+ *
+ * This file exposes the primitives X-Lock derives keys, tokens and
+ * nonces with. By default they are backed by OpenSSL, reusing one MAC
+ * context per thread. Building with -D_NO_OPENSSL_ selects a built-in
+ * SHA-256 and the getrandom() system call instead.
+ */
+
+#include <stddef.h>
+
+/**
+ * @brief HMAC-SHA256 output length in bytes
+ */
+#define HMAC_BYTES 32
+
+/**
+ * @brief computes HMAC-SHA256
+ *
+ * @param key MAC key
+ * @param key_len key length in bytes
+ * @param data message
+ * @param data_len message length in bytes
+ * @param md storage for HMAC_BYTES bytes
+ * @return 0 on success, -1 on failure
+ */
+int hmac_sha256(unsigned char *key, size_t key_len, unsigned char *data, size_t data_len, unsigned char *md);
+
+/**
+ * @brief fills a buffer with cryptographically secure random bytes
+ *
+ * @param b buffer
+ * @param size buffer length in bytes
+ * @return 0 on success, -1 on failure
+ */
+int random_bytes(unsigned char *b, size_t size);
+
+#endif
@@ -8,11 +8,30 @@
  * This file exposes APIs for random index generation.
  */
 
+#include <stdint.h>
+
+/**
+ * @brief returns an output of a counter-based PRNG
+ * 
+ * This function returns the nth output of the PRNG stream identified
+ * by seed. Outputs are computed directly from seed and n, hence they
+ * can be produced in any order, from any thread, and they are the
+ * same on every platform.
+ * 
+ * @param seed seed of the stream
+ * @param n position in the stream
+ * @return the nth output of the stream
+ * @see SplitMix64
+ */
+uint64_t prng_counter(uint64_t seed, uint64_t n);
+
 /**
  * @brief produces a list of PRNG-based random numbers
  * 
  * This function produces size numbers in the range [lowerbound, upperbound)
- * seeding a PRNG with seed. Replacement can be specified.
+ * seeding a PRNG with seed. Replacement can be specified. Without
+ * replacement, the numbers are the first size numbers of the permutation
+ * produced by prng_rand_permutation() with the same seed.
  * 
  * @param seed seed for the PRNG
  * @param size number of indexes
@@ -47,7 +66,8 @@ double prng_rand_with_replacement(unsigned long *seed, size_t size, unsigned *in
  * @brief produces a list of PRNG-based random numbers without replacement
  * 
  * This function produces size numbers in the range [lowerbound, upperbound)
- * seeding a PRNG with seed without replacement.
+ * seeding a PRNG with seed without replacement. Time and memory depend
+ * on size only, not on the width of the range.
  * 
  * @param seed seed for the PRNG
  * @param size number of indexes
@@ -60,4 +80,42 @@ double prng_rand_with_replacement(unsigned long *seed, size_t size, unsigned *in
  */
 double prng_rand_without_replacement(unsigned long *seed, size_t size, unsigned *indexes, unsigned lowerbound, unsigned upperbound);
 
+/**
+ * @brief produces a slice of a PRNG-based random permutation
+ * 
+ * This function produces the numbers in positions [offset, offset + size)
+ * of a random permutation of [lowerbound, upperbound) determined by seed.
+ * Every slice is computed independently, so callers can derive only the
+ * numbers they need, in any order, while numbers stay unique across
+ * the whole permutation.
+ * 
+ * @param seed seed for the PRNG
+ * @param offset position of the first number in the permutation
+ * @param size number of indexes
+ * @param indexes pointer to the array of indexes
+ * @param lowerbound lowest index value, included
+ * @param upperbound highest index value, excluded
+ * @return a negative value upon error, either 0 or the time in milliseconds
+ * @see PRNG
+ * @note if seed is NULL, it will be initialized.
+ */
+double prng_rand_permutation(unsigned long *seed, size_t offset, size_t size, unsigned *indexes, unsigned lowerbound, unsigned upperbound);
+
+/**
+ * @brief produces a slice of a PRNG-based random permutation, 16-bit
+ * 
+ * This function behaves as prng_rand_permutation(), storing indexes
+ * in 16 bits.
+ * 
+ * @param seed seed for the PRNG
+ * @param offset position of the first number in the permutation
+ * @param size number of indexes
+ * @param indexes pointer to the array of indexes
+ * @param lowerbound lowest index value, included
+ * @param upperbound highest index value, excluded, at most 65536
+ * @return a negative value upon error, either 0 or the time in milliseconds
+ * @see prng_rand_permutation
+ */
+double prng_rand_permutation16(unsigned long *seed, size_t offset, size_t size, uint16_t *indexes, unsigned lowerbound, unsigned upperbound);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,106 @@
+#ifndef PLAN_H
+#define PLAN_H
+
+/**
+ * @file plan.h
+ * @brief Unlock plan cache
+ *
+ * This file exposes a bounded cache of unlock plans. A plan holds the
+ * key indexes and the source indexes of the bit-lockers forming key_pre
+ * for a (source_seed, key_seed) pair, so that repeated reproductions
+ * against the same pair skip index generation entirely.
+ */
+
+#include <stddef.h>
+
+#include "context.h"
+
+/**
+ * @brief cached plan of a (source_seed, key_seed) pair
+ */
+struct plan_entry
+{
+    unsigned long source_seed; /**< source seed of the plan */
+    unsigned long key_seed;    /**< key seed of the plan */
+    unsigned long hash;        /**< hash of the seed pair */
+    unsigned int slot;         /**< position in the hash table */
+    unsigned int prev;         /**< more recently used entry */
+    unsigned int next;         /**< less recently used entry */
+};
+
+/**
+ * @brief LRU cache of unlock plans
+ *
+ * Plans are stored in a caller-supplied buffer and looked up through an
+ * open-addressing hash table. When the cache is full, the least recently
+ * used plan is evicted. A cache must not be used by more than one thread
+ * at a time.
+ */
+struct plan_cache
+{
+    struct xlock_params params;  /**< parameters of the cached plans */
+    unsigned int capacity;       /**< maximum number of plans */
+    unsigned int used;           /**< number of cached plans */
+    unsigned int head;           /**< most recently used entry */
+    unsigned int tail;           /**< least recently used entry */
+    unsigned int mask;           /**< hash table size - 1 */
+    size_t plan_size;            /**< bytes per plan */
+    struct plan_entry *entries;  /**< capacity entries */
+    unsigned int *slots;         /**< hash table, entry + 1 or 0 if empty */
+    unsigned char *plans;        /**< capacity * plan_size bytes */
+    unsigned long hits;          /**< lookups served from the cache */
+    unsigned long misses;        /**< lookups that derived a plan */
+    unsigned long evictions;     /**< plans evicted to make room */
+};
+
+/**
+ * @brief returns the storage size of a plan cache
+ *
+ * @param params X-Lock parameters
+ * @param capacity maximum number of plans
+ * @return the size in bytes of the buffer needed by plan_cache_init()
+ */
+size_t plan_cache_size(struct xlock_params *params, unsigned int capacity);
+
+/**
+ * @brief initializes an empty plan cache
+ *
+ * @param cache plan cache
+ * @param params X-Lock parameters
+ * @param capacity maximum number of plans
+ * @param buf storage buffer
+ * @param size size of buf in bytes, at least plan_cache_size()
+ * @return 0 on success, -1 if capacity is 0 or buf is too small
+ */
+int plan_cache_init(
+    struct plan_cache *cache,
+    struct xlock_params *params,
+    unsigned int capacity,
+    void *buf,
+    size_t size);
+
+/**
+ * @brief retrieves the plan of a seed pair
+ *
+ * This function returns the cached plan of the pair, deriving and
+ * caching it on a miss. The plan holds key_pre_bits key indexes followed
+ * by key_pre_bits * n_locks * n_xoration source indexes, laid out as
+ * unlock() expects them and stored as xlock_indexes() does.
+ *
+ * @param cache plan cache
+ * @param source_seed source seed for indexes to unlock vault, not 0
+ * @param key_seed key seed for indexes that form the key, not 0
+ * @return the plan, valid until the next call on cache
+ */
+void *plan_cache_get(struct plan_cache *cache, unsigned long source_seed, unsigned long key_seed);
+
+/**
+ * @brief empties a plan cache
+ *
+ * @param cache plan cache
+ * @return void
+ * @note hit, miss and eviction counters are reset too.
+ */
+void plan_cache_clear(struct plan_cache *cache);
+
+#endif
@@ -0,0 +1,70 @@
+#ifndef PROFILE_H
+#define PROFILE_H
+
+/**
+ * @file profile.h
+ * @brief Specialized lock/unlock profiles
+ *
+ * This file exposes lock_range() and unlock() kernels specialized at compile
+ * time for fixed (n_locks, n_xoration) profiles, and their lookup.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief lock() and unlock() kernels of a fixed profile
+ *
+ * The kernels behave as lock_range() and unlock() with n_locks and
+ * n_xoration fixed to the values of the profile, with 32-bit or 16-bit
+ * indexes.
+ *
+ * @see lock_range
+ * @see unlock
+ */
+struct profile
+{
+    unsigned int n_locks;
+    unsigned int n_xoration;
+    void (*lock)(
+        unsigned char *source,
+        unsigned int *source_indexes,
+        unsigned char *pool,
+        unsigned int first,
+        unsigned int count,
+        unsigned char *vault);
+    void (*unlock)(
+        unsigned char *source,
+        unsigned int *source_indexes,
+        unsigned char *vault,
+        unsigned char *key,
+        unsigned int *key_indexes,
+        unsigned int key_bits);
+    void (*lock16)(
+        unsigned char *source,
+        uint16_t *source_indexes,
+        unsigned char *pool,
+        unsigned int first,
+        unsigned int count,
+        unsigned char *vault);
+    void (*unlock16)(
+        unsigned char *source,
+        uint16_t *source_indexes,
+        unsigned char *vault,
+        unsigned char *key,
+        uint16_t *key_indexes,
+        unsigned int key_bits);
+};
+
+/**
+ * @brief looks up the specialized kernels of a profile
+ *
+ * @param n_locks number of locks per bit-locker
+ * @param n_xoration number of bits per XOR-ation
+ * @return the kernels of the profile, NULL if it is not specialized
+ * @note profiles are not built along with the SIMD gather kernels, which
+ * are faster, so this function always returns NULL where GATHER_X86 is
+ * defined.
+ */
+struct profile *profile_select(unsigned int n_locks, unsigned int n_xoration);
+
+#endif
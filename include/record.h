@@ -0,0 +1,173 @@
+#ifndef RECORD_H
+#define RECORD_H
+
+/**
+ * @file record.h
+ * @brief Helper data records
+ *
+ * This file exposes the on-disk format of the public helper data of a
+ * device: parameters, seeds, nonce, vault, token and an optional error
+ * map. A record is a fixed header followed by its arrays, every field
+ * naturally aligned and every record a multiple of XLOCK_RECORD_ALIGN
+ * bytes. Records can thus be concatenated in a file, mapped in memory
+ * and reproduced in place, without parsing or copying.
+ *
+ * Records are stored in host byte order. The magic number reads
+ * differently on a host of the other byte order, so that such records
+ * are rejected rather than misread.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+
+/**
+ * @brief magic number of a record, "XLK1" on little-endian hosts
+ */
+#define XLOCK_RECORD_MAGIC 0x314b4c58
+
+/**
+ * @brief version of the record format
+ */
+#define XLOCK_RECORD_VERSION 1
+
+/**
+ * @brief alignment of records and of their arrays
+ */
+#define XLOCK_RECORD_ALIGN 8
+
+/**
+ * @brief flag of records holding an error map
+ */
+#define XLOCK_RECORD_E_MAP 1
+
+/**
+ * @brief header of a record
+ *
+ * Offsets are counted from the start of the record. The error map
+ * offset is 0 when the record holds no map.
+ */
+struct xlock_record
+{
+    uint32_t magic;        /**< XLOCK_RECORD_MAGIC */
+    uint16_t version;      /**< XLOCK_RECORD_VERSION */
+    uint16_t flags;        /**< XLOCK_RECORD_E_MAP if a map follows */
+    uint32_t size;         /**< record length in bytes, header included */
+    uint32_t source_bits;  /**< source length in bits */
+    uint32_t pool_bits;    /**< pool length in bits */
+    uint32_t key_bits;     /**< key length in bits */
+    uint32_t key_pre_bits; /**< key_pre length in bits */
+    uint32_t token_bytes;  /**< robustness token length in bytes */
+    uint32_t n_locks;      /**< number of locks per bit-locker */
+    uint32_t n_xoration;   /**< number of bits per XOR-ation */
+    uint64_t source_seed;  /**< source seed for indexes to unlock vault */
+    uint64_t key_seed;     /**< key seed for indexes that form the key */
+    uint64_t nonce;        /**< nonce for final key generation */
+    uint32_t vault;        /**< offset of the vault */
+    uint32_t token;        /**< offset of the robustness token */
+    uint32_t e_map;        /**< offset of the error map, or 0 */
+    uint32_t reserved;     /**< 0 */
+};
+
+/**
+ * @brief returns the length of a record
+ *
+ * @param params X-Lock parameters
+ * @param e_map 0 for a record without error map, otherwise with
+ * @return the record length in bytes, a multiple of XLOCK_RECORD_ALIGN
+ */
+size_t xlock_record_size(struct xlock_params *params, int e_map);
+
+/**
+ * @brief writes a record
+ *
+ * @param rec storage for the record, aligned to XLOCK_RECORD_ALIGN
+ * @param size size of rec in bytes
+ * @param params X-Lock parameters
+ * @param source_seed source seed for indexes to unlock vault
+ * @param key_seed key seed for indexes that form the key
+ * @param nonce nonce for final key generation
+ * @param vault encrypted vault
+ * @param token robustness token
+ * @param e_map error map as given to xlock_ctx_set_reliability(), or
+ * NULL
+ * @return 0 on success, -1 if rec is too small or misaligned
+ */
+int xlock_record_write(
+    struct xlock_record *rec,
+    size_t size,
+    struct xlock_params *params,
+    unsigned long source_seed,
+    unsigned long key_seed,
+    unsigned long nonce,
+    unsigned char *vault,
+    unsigned char *token,
+    unsigned char *e_map);
+
+/**
+ * @brief validates a record
+ *
+ * This function checks the magic number, the version, the parameters
+ * and that every array lies within size bytes and is aligned. Records
+ * that pass can be used with the accessors below.
+ *
+ * @param rec record, aligned to XLOCK_RECORD_ALIGN
+ * @param size bytes available from rec
+ * @return 0 if rec is a valid record, -1 otherwise
+ */
+int xlock_record_check(struct xlock_record *rec, size_t size);
+
+/**
+ * @brief retrieves the parameters of a record
+ *
+ * @param rec valid record
+ * @param params storage for the parameters
+ * @return void
+ */
+void xlock_record_params(struct xlock_record *rec, struct xlock_params *params);
+
+/**
+ * @brief returns the vault of a record
+ *
+ * @param rec valid record
+ * @return the vault, in place
+ */
+unsigned char *xlock_record_vault(struct xlock_record *rec);
+
+/**
+ * @brief returns the robustness token of a record
+ *
+ * @param rec valid record
+ * @return the token, in place
+ */
+unsigned char *xlock_record_token(struct xlock_record *rec);
+
+/**
+ * @brief returns the error map of a record
+ *
+ * @param rec valid record
+ * @return the error map, in place, or NULL if the record has none
+ */
+unsigned char *xlock_record_e_map(struct xlock_record *rec);
+
+/**
+ * @brief rep procedure of the fuzzy extractor on a record
+ *
+ * This function reproduces the key of a record in place: the vault,
+ * token and error map are read where the record lies, which may be
+ * read-only mapped memory. A record error map replaces the one of ctx
+ * for this call.
+ *
+ * @param ctx context, initialized with the parameters of rec
+ * @param rec valid record
+ * @param read reading from source
+ * @param key key storage
+ * @return 0 if the key was reproduced, -1 if it was not or if ctx does
+ * not match rec
+ * @see xlock_ctx_rep
+ * @note on failure, key is nullified.
+ */
+int xlock_record_rep(struct xlock_ctx *ctx, struct xlock_record *rec, unsigned char *read, unsigned char *key);
+
+#endif
@@ -0,0 +1,88 @@
+#ifndef SIM_H
+#define SIM_H
+
+/**
+ * @file sim.h
+ * @brief Monte Carlo estimation of the key failure probability
+ *
+ * This file exposes a multithreaded simulator of X-Lock reproductions.
+ * Every trial draws its seeds, pool and reading noise from its own
+ * counter-based PRNG stream, so the outcome of a trial depends only on
+ * the base seed and on the trial number. Results are therefore the same
+ * whatever the number of threads.
+ */
+
+#include <stdint.h>
+
+#include "context.h"
+
+/**
+ * @brief outcome of a simulation
+ */
+struct xlock_sim_result
+{
+    uint64_t trials;   /**< number of trials */
+    uint64_t failures; /**< trials where key_pre was not reproduced */
+    uint64_t bits;     /**< wrong key_pre bits over every trial */
+    double p;          /**< estimated key failure probability */
+    double lo;         /**< lower bound of the confidence interval */
+    double hi;         /**< upper bound of the confidence interval */
+};
+
+/**
+ * @brief simulates reproductions of a parameter set
+ *
+ * Each trial enrolls a random pool with fresh seeds, flips every source
+ * bit with probability e_abs and counts a failure if key_pre differs
+ * from the enrolled one. The confidence interval is the Wilson score
+ * interval for the normal quantile z, which stays meaningful when no
+ * failure is observed.
+ *
+ * @param params X-Lock parameters
+ * @param e_abs absolute error probability
+ * @param trials number of trials
+ * @param n_threads number of threads, 0 for one per online CPU
+ * @param seed base seed
+ * @param z normal quantile of the confidence level, e.g. 1.96 for 95%
+ * @param res storage for the outcome
+ * @return 0 on success, -1 if params are invalid or the threads could
+ * not be started
+ */
+int xlock_sim_run(
+    struct xlock_params *params,
+    float e_abs,
+    uint64_t trials,
+    unsigned int n_threads,
+    uint64_t seed,
+    double z,
+    struct xlock_sim_result *res);
+
+/**
+ * @brief simulates reproductions of a parameter set, 64 at a time
+ *
+ * This function behaves as xlock_sim_run(), with a bit-sliced kernel:
+ * each group of 64 consecutive trials shares a pair of seeds, hence its
+ * indexes, while pools and noise stay independent per trial. Index
+ * generation is then paid once per group.
+ *
+ * @param params X-Lock parameters
+ * @param e_abs absolute error probability
+ * @param trials number of trials
+ * @param n_threads number of threads, 0 for one per online CPU
+ * @param seed base seed
+ * @param z normal quantile of the confidence level, e.g. 1.96 for 95%
+ * @param res storage for the outcome
+ * @return 0 on success, -1 if params are invalid or the threads could
+ * not be started
+ * @see xlock_sim_run
+ */
+int xlock_sim_run64(
+    struct xlock_params *params,
+    float e_abs,
+    uint64_t trials,
+    unsigned int n_threads,
+    uint64_t seed,
+    double z,
+    struct xlock_sim_result *res);
+
+#endif
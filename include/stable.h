@@ -0,0 +1,131 @@
+#ifndef STABLE_H
+#define STABLE_H
+
+/**
+ * @file stable.h
+ * @brief Rank/select over the stable bits of a source
+ *
+ * This file exposes a rank/select structure over a bitmap of the source
+ * bits deemed stable. Source indexes are then drawn among the stable
+ * bits only, as ranks, and mapped to source positions with select, so
+ * that known-unstable cells never enter a bit-locker.
+ *
+ * Ranks are stored for every 64-bit word, and the word holding every
+ * 64th stable bit is sampled. Rank thus takes one popcount, and select
+ * scans the words spanning 64 stable bits, at most span of them. Where
+ * stable bits are sparse the span grows with the gaps between them, so
+ * contexts only accept bitmaps whose span is at most XLOCK_STABLE_SPAN.
+ * Ranks and samples take about as much memory as the bitmap, and are
+ * built in one pass over its words.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "gather.h"
+
+/**
+ * @brief most words select may scan past a sample
+ *
+ * A span of 16 words lets 64 stable bits spread over 1088 source bits,
+ * that is a local density of stable bits down to about 6%.
+ */
+#define XLOCK_STABLE_SPAN 16
+
+/**
+ * @brief rank/select structure over a bitmap of stable bits
+ *
+ * The arrays refer to the buffer passed to xlock_stable_init(), which
+ * must outlive the structure.
+ */
+struct xlock_stable
+{
+    unsigned int source_bits; /**< source length in bits */
+    unsigned int n_stable;    /**< number of stable bits */
+    uint64_t *bits;           /**< bitmap, 64 bits per word */
+    uint32_t *rank;           /**< stable bits before each word, and in total */
+    uint32_t *samples;        /**< word of every 64th stable bit */
+    unsigned int span;        /**< most words select scans past a sample */
+    unsigned int (*select64)(uint64_t w, unsigned int k); /**< select within a word */
+};
+
+/**
+ * @brief returns the position of the kth bit set of a word
+ *
+ * Portable kernel of the select64 field, keeping the half of the word
+ * holding the bit six times.
+ *
+ * @param w word
+ * @param k rank of the bit, less than popcount64(w)
+ * @return the position of the bit
+ */
+unsigned int stable_select64(uint64_t w, unsigned int k);
+
+#ifdef GATHER_X86
+/**
+ * @brief stable_select64() with BMI2
+ *
+ * @see stable_select64
+ * @note the CPU must support BMI2.
+ */
+unsigned int stable_select64_bmi2(uint64_t w, unsigned int k);
+#endif
+
+/**
+ * @brief builds a bitmap of stable bits from an error map
+ *
+ * @param e_map source_bits error probabilities in 1/256, as given by
+ * reliability_map() or fuse_reads()
+ * @param source_bits source length in bits
+ * @param e_max largest error probability of a stable bit
+ * @param bitmap storage for bits_to_bytes(source_bits) bytes, bit i set
+ * if bit i is stable
+ * @return the number of stable bits
+ */
+unsigned int xlock_stable_bitmap(unsigned char *e_map, unsigned int source_bits, unsigned char e_max, unsigned char *bitmap);
+
+/**
+ * @brief returns the storage size of a rank/select structure
+ *
+ * @param source_bits source length in bits
+ * @return the size in bytes of the buffer needed by xlock_stable_init()
+ */
+size_t xlock_stable_size(unsigned int source_bits);
+
+/**
+ * @brief builds a rank/select structure
+ *
+ * @param stable rank/select structure
+ * @param bitmap bitmap of stable bits, bit i set if bit i is stable
+ * @param source_bits source length in bits
+ * @param buf storage buffer
+ * @param size size of buf in bytes, at least xlock_stable_size()
+ * @return 0 on success, -1 if buf is too small
+ */
+int xlock_stable_init(
+    struct xlock_stable *stable,
+    unsigned char *bitmap,
+    unsigned int source_bits,
+    void *buf,
+    size_t size);
+
+/**
+ * @brief returns the number of stable bits before a position
+ *
+ * @param stable rank/select structure
+ * @param i source position, at most source_bits
+ * @return the number of stable bits in [0, i)
+ */
+unsigned int xlock_stable_rank(struct xlock_stable *stable, unsigned int i);
+
+/**
+ * @brief returns the position of a stable bit
+ *
+ * @param stable rank/select structure
+ * @param k rank of the stable bit, less than n_stable
+ * @return the source position of the stable bit of rank k
+ * @note select scans at most stable->span + 1 words.
+ */
+unsigned int xlock_stable_select(struct xlock_stable *stable, unsigned int k);
+
+#endif
@@ -0,0 +1,117 @@
+#ifndef STATS_H
+#define STATS_H
+
+/**
+ * @file stats.h
+ * @brief Per-phase latency counters
+ *
+ * This file exposes the counters gen and rep accumulate for each of
+ * their phases: index generation, unlock, key derivation and token
+ * derivation. Every phase records its number of runs, its wall-clock
+ * time and, on x86, its time stamp counter cycles. Counters are kept
+ * per thread, so recording never takes a lock. They are disabled by
+ * default.
+ */
+
+#include <stdint.h>
+
+/**
+ * @brief phases of gen and rep
+ */
+enum xlock_phase
+{
+    XLOCK_PHASE_INDEXES, /**< key and source index generation */
+    XLOCK_PHASE_UNLOCK,  /**< bit-locker unlocking */
+    XLOCK_PHASE_KEY,     /**< key = hash(key_pre, nonce) */
+    XLOCK_PHASE_TOKEN,   /**< token = hash(key, key_seed) */
+    XLOCK_PHASES         /**< number of phases */
+};
+
+/**
+ * @brief counters of a phase
+ */
+struct xlock_phase_stats
+{
+    uint64_t runs;   /**< number of runs */
+    uint64_t ns;     /**< wall-clock time in nanoseconds */
+    uint64_t cycles; /**< time stamp counter cycles, 0 if unavailable */
+};
+
+/**
+ * @brief counters of every phase
+ */
+struct xlock_stats
+{
+    struct xlock_phase_stats phases[XLOCK_PHASES]; /**< counters by phase */
+};
+
+/**
+ * @brief running measurement of a phase
+ */
+struct xlock_probe
+{
+    int on;          /**< counters were enabled at start */
+    uint64_t ns;     /**< start time in nanoseconds */
+    uint64_t cycles; /**< start time stamp counter */
+};
+
+/**
+ * @brief enables or disables the counters of every thread
+ *
+ * @param enable 0 to disable, otherwise enable
+ * @return void
+ */
+void xlock_stats_enable(int enable);
+
+/**
+ * @brief returns the counters of the calling thread
+ *
+ * @param stats storage for the counters
+ * @return void
+ */
+void xlock_stats_thread(struct xlock_stats *stats);
+
+/**
+ * @brief returns the counters summed over every thread
+ *
+ * Threads that exited still account for the phases they ran. Phases
+ * running concurrently may be missing from the sum.
+ *
+ * @param stats storage for the counters
+ * @return void
+ */
+void xlock_stats_total(struct xlock_stats *stats);
+
+/**
+ * @brief clears the counters of the calling thread
+ *
+ * @return void
+ */
+void xlock_stats_reset(void);
+
+/**
+ * @brief returns the name of a phase
+ *
+ * @param phase phase
+ * @return a static string naming phase
+ */
+const char *xlock_phase_name(enum xlock_phase phase);
+
+/**
+ * @brief starts measuring a phase
+ *
+ * @param probe measurement storage
+ * @return void
+ */
+void xlock_probe_start(struct xlock_probe *probe);
+
+/**
+ * @brief stops measuring a phase and accounts it to the calling thread
+ *
+ * @param probe measurement started by xlock_probe_start()
+ * @param phase measured phase
+ * @return void
+ */
+void xlock_probe_stop(struct xlock_probe *probe, enum xlock_phase phase);
+
+#endif
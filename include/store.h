@@ -0,0 +1,156 @@
+#ifndef STORE_H
+#define STORE_H
+
+/**
+ * @file store.h
+ * @brief Memory-mapped helper data store
+ *
+ * This file exposes a file-backed store of helper data records, indexed
+ * by device ID. The file is mapped in memory: opening it costs the same
+ * whatever the number of devices, and a lookup probes an open-addressing
+ * table stored in the file itself before returning the record in place.
+ *
+ * The capacity of a store is fixed at creation. A store may be read by
+ * several processes at once, but written by one thread at a time and
+ * not while it is read.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "context.h"
+#include "record.h"
+
+/**
+ * @brief magic number of a store file, "XLS1" on little-endian hosts
+ */
+#define XLOCK_STORE_MAGIC 0x31534c58
+
+/**
+ * @brief version of the store format
+ */
+#define XLOCK_STORE_VERSION 1
+
+/**
+ * @brief header of a store file
+ *
+ * The slot table follows the header, and the records follow the slot
+ * table, appended one after the other.
+ */
+struct xlock_store_header
+{
+    uint32_t magic;    /**< XLOCK_STORE_MAGIC */
+    uint16_t version;  /**< XLOCK_STORE_VERSION */
+    uint16_t reserved; /**< 0 */
+    uint64_t slots;    /**< number of slots, a power of 2 */
+    uint64_t count;    /**< number of stored devices */
+    uint64_t index;    /**< offset of the slot table */
+    uint64_t records;  /**< offset of the first record */
+    uint64_t used;     /**< offset past the last record */
+    uint64_t size;     /**< file length */
+};
+
+/**
+ * @brief slot of the device index
+ */
+struct xlock_store_slot
+{
+    uint64_t device_id; /**< device ID */
+    uint64_t offset;    /**< offset of the record, 0 if the slot is free */
+};
+
+/**
+ * @brief open store
+ */
+struct xlock_store
+{
+    int fd;                            /**< file descriptor */
+    int writable;                      /**< the store was opened for writing */
+    unsigned char *map;                /**< mapped file */
+    struct xlock_store_header *header; /**< header, in place */
+    struct xlock_store_slot *slots;    /**< slot table, in place */
+};
+
+/**
+ * @brief creates a store file and opens it for writing
+ *
+ * The slot table gets at least twice as many slots as devices, so that
+ * probes stay short when the store is full.
+ *
+ * @param store store
+ * @param path file path, truncated if it exists
+ * @param max_devices number of devices the store can hold
+ * @param record_bytes space reserved per device, as given by
+ * xlock_record_size()
+ * @return 0 on success, -1 if max_devices or record_bytes is 0 or too
+ * large, or if the file cannot be created or mapped
+ */
+int xlock_store_create(struct xlock_store *store, const char *path, uint64_t max_devices, size_t record_bytes);
+
+/**
+ * @brief opens a store file
+ *
+ * @param store store
+ * @param path file path
+ * @param writable 0 to map the file read-only, otherwise read-write
+ * @return 0 on success, -1 if the file cannot be mapped or is not a
+ * valid store
+ * @note the header is fully checked against the file length, so that a
+ * corrupt file is rejected rather than read out of bounds.
+ */
+int xlock_store_open(struct xlock_store *store, const char *path, int writable);
+
+/**
+ * @brief adds or replaces the record of a device
+ *
+ * A record replacing another one of the same size is overwritten in
+ * place, otherwise it is appended and the old one is left unused.
+ *
+ * @param store store opened for writing
+ * @param device_id device ID
+ * @param rec valid record
+ * @return 0 on success, -1 if the store is read-only or full
+ */
+int xlock_store_put(struct xlock_store *store, uint64_t device_id, struct xlock_record *rec);
+
+/**
+ * @brief finds the record of a device
+ *
+ * @param store store
+ * @param device_id device ID
+ * @return the record, in place, or NULL if the device is unknown or its
+ * record is invalid
+ */
+struct xlock_record *xlock_store_get(struct xlock_store *store, uint64_t device_id);
+
+/**
+ * @brief reproduces the key of a device
+ *
+ * @param ctx context, initialized with the parameters of the device
+ * @param store store
+ * @param device_id device ID
+ * @param read reading from the source of the device
+ * @param key key storage
+ * @return 0 if the key was reproduced, -1 if it was not or if the
+ * device is unknown
+ * @see xlock_record_rep
+ * @note on failure, key is nullified.
+ */
+int xlock_store_rep(
+    struct xlock_ctx *ctx,
+    struct xlock_store *store,
+    uint64_t device_id,
+    unsigned char *read,
+    unsigned char *key);
+
+/**
+ * @brief closes a store
+ *
+ * A store opened for writing is flushed to its file first.
+ *
+ * @param store store
+ * @return void
+ */
+void xlock_store_close(struct xlock_store *store);
+
+#endif
@@ -9,6 +9,13 @@
  * resource constrained devices.
  */
 
+#include <stdint.h>
+
+/**
+ * @brief largest source length in bits addressable by 16-bit indexes
+ */
+#define INDEX16_BITS 65536
+
 /**
  * @brief retrieves the value of a bit in a 1-D array
 
@@ -21,6 +28,47 @@
  */
 unsigned char get_bit(unsigned char *b, int i);
 
+/**
+ * @brief retrieves a run of bits from a 1-D array
+
+ * This function retrieves n consecutive bits starting at position i
+ * in a 1-D array of bits. Bit i ends up in the least significant bit.
+ * 
+ * @param b array of bits
+ * @param i position of the first bit
+ * @param n number of bits, at most 64
+ * @return the n bits starting at position i
+ */
+uint64_t get_bits(unsigned char *b, unsigned int i, unsigned int n);
+
+/**
+ * @brief sets a run of bits in a 1-D array
+
+ * This function sets n consecutive bits starting at position i
+ * in a 1-D array of bits, bit i taking the least significant bit
+ * of v. The other bits of the array are left untouched.
+ * 
+ * @param b array of bits
+ * @param i position of the first bit
+ * @param n number of bits, at most 64
+ * @param v bit values
+ * @return void
+ */
+void set_bits(unsigned char *b, unsigned int i, unsigned int n, uint64_t v);
+
+/**
+ * @brief sets the value of a bit in a 1-D array
+
+ * This function sets the value of the bit in position i
+ * in a 1-D array of bits.
+ * 
+ * @param b array of bits
+ * @param i bit position
+ * @param v bit value
+ * @return void
+ */
+void set_bit_v(unsigned char *b, int i, unsigned char v);
+
 /**
  * @brief randomly initializes b
  * 
@@ -36,7 +84,8 @@ void init_random(unsigned char *b, int size);
  * @brief randomly changes b
  * 
  * This function randomly changes b by modifying some of it bytes. e_abs
- * speicifies the probability that a bit is flipped.
+ * speicifies the probability that a bit is flipped. The noise stream is
+ * keyed by rand(), so srand() makes it reproducible.
  * 
  * @param b input array of bits
  * @param out output array of bits
@@ -50,6 +99,73 @@ void change_random(
     int size,
     float e_abs);
 
+/**
+ * @brief randomly changes b with a per-bit error probability
+ *
+ * This function behaves as change_random(), bit i being flipped with
+ * probability e_map[i] / 256. Maps model biased sources, where some
+ * bits are far less stable than others.
+ *
+ * @param b input array of bits
+ * @param out output array of bits
+ * @param size size of b and out in bytes
+ * @param e_map 8 * size error probabilities, in 1/256
+ * @return void
+ * @see change_random
+ */
+void change_random_map(
+    unsigned char *b,
+    unsigned char *out,
+    int size,
+    unsigned char *e_map);
+
+/**
+ * @brief draws 64 independent Bernoulli bits
+ *
+ * Bit t of the result is set when the tth of 64 uniform 32-bit draws
+ * falls below thres. The draws are compared one bit plane at a time
+ * and planes stop being drawn once every comparison is settled, which
+ * takes about 8 PRNG outputs. Word n only depends on key and n.
+ *
+ * @param key stream key
+ * @param n position of the word in the stream
+ * @param thres error probability scaled to 2^32
+ * @return the 64 Bernoulli bits
+ */
+uint64_t noise_word(uint64_t key, uint64_t n, uint32_t thres);
+
+/**
+ * @brief converts an error probability into a noise_word() threshold
+ *
+ * @param e_abs absolute error probability
+ * @return e_abs scaled to 2^32, saturated to [0, 2^32 - 1]
+ */
+uint32_t noise_thres(float e_abs);
+
+/**
+ * @brief draws uniform noise
+ *
+ * @param key stream key
+ * @param noise storage for the noise, each bit set with probability e_abs
+ * @param size size of noise in bytes
+ * @param e_abs absolute error probability
+ * @return void
+ * @see noise_word
+ */
+void noise_uniform(uint64_t key, unsigned char *noise, int size, float e_abs);
+
+/**
+ * @brief draws noise from a per-bit error probability map
+ *
+ * @param key stream key
+ * @param noise storage for the noise, bit i set with probability
+ * e_map[i] / 256
+ * @param size size of noise in bytes
+ * @param e_map 8 * size error probabilities, in 1/256
+ * @return void
+ */
+void noise_map(uint64_t key, unsigned char *noise, int size, unsigned char *e_map);
+
 /**
  * @brief creates the vault needed for the fuzzy extractor
  *
@@ -75,16 +191,70 @@ void lock(
     unsigned int n_xoration,
     unsigned char *vault);
 
+/**
+ * @brief locks a range of bit-lockers of the vault
+ *
+ * This function encrypts the count bits of pool starting at position
+ * first, as lock() does for the whole pool. The result is stored in
+ * the corresponding bit-lockers of vault.
+ *
+ * @param source preferred state of source
+ * @param source_indexes source indexes of the bit-lockers to lock,
+ * n_locks * n_xoration per bit-locker
+ * @param pool random pool
+ * @param first first bit-locker to lock
+ * @param count number of bit-lockers to lock
+ * @param n_locks number of locks per bit-locker
+ * @param n_xoration number of bits per XOR-ation
+ * @param vault encrypted vault
+ * @return void
+ */
+void lock_range(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned char *pool,
+    unsigned int first,
+    unsigned int count,
+    unsigned int n_locks,
+    unsigned int n_xoration,
+    unsigned char *vault);
+
+/**
+ * @brief derives the source indexes of the lockers in key_indexes
+ *
+ * This function produces, for every key bit, the n_locks * n_xoration
+ * source indexes of the bit-locker selected by key_indexes. Only the
+ * needed slices of the source index permutation are computed.
+ *
+ * @param source_seed source seed for indexes to unlock vault
+ * @param source_bits source length in bits
+ * @param key_indexes vault indexes to form the key
+ * @param key_bits key length in bits
+ * @param n_locks number of locks per bit-locker
+ * @param n_xoration number of bits per XOR-ation
+ * @param source_indexes source indexes of the selected bit-lockers
+ * @return void
+ */
+void locker_indexes(
+    unsigned long *source_seed,
+    unsigned int source_bits,
+    unsigned int *key_indexes,
+    unsigned int key_bits,
+    unsigned int n_locks,
+    unsigned int n_xoration,
+    unsigned int *source_indexes);
+
 /**
  * @brief unlocks the vault and retrieves key_pre
  *
- * This function decrypts pool by means of subsets of bits from
- * source according to source_indexes. The result is not stored.
- * After the decryption, the function builds key_pre according
- * to key_indexes.
+ * This function decrypts the bits of pool selected by key_indexes
+ * by means of subsets of bits from source according to
+ * source_indexes. The result is not stored. After the decryption,
+ * the function builds key_pre according to key_indexes.
  * 
  * @param source reference source
- * @param source_indexes source indexes to unlock vault
+ * @param source_indexes source indexes of the bit-lockers in
+ * key_indexes, n_locks * n_xoration per key bit
  * @param vault reference vault
  * @param key reference key
  * @param key_indexes vault indexes to form the key
@@ -103,6 +273,247 @@ void unlock(
     unsigned int n_locks,
     unsigned int n_xoration);
 
+/**
+ * @brief unlocks the vault and retrieves key_pre, voting lazily
+ *
+ * This function behaves as unlock(), but evaluates the locks of a
+ * bit-locker in runs and stops as soon as the majority is settled,
+ * either because more than n_locks / 2 locks agree already or because
+ * the remaining locks can no longer reach that threshold. key_pre is
+ * identical to the one of unlock().
+ * 
+ * @param source reference source
+ * @param source_indexes source indexes of the bit-lockers in
+ * key_indexes, n_locks * n_xoration per key bit
+ * @param vault reference vault
+ * @param key reference key
+ * @param key_indexes vault indexes to form the key
+ * @param key_bits key length in bits
+ * @param n_locks number of locks per bit-locker
+ * @param n_xoration number of bits per XOR-ation
+ * @return the number of locks skipped over all bit-lockers
+ * @note the execution time depends on read, as it is the case for the
+ * number of skipped locks.
+ */
+unsigned long unlock_early(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned char *vault,
+    unsigned char *key,
+    unsigned int *key_indexes,
+    unsigned int key_bits,
+    unsigned int n_locks,
+    unsigned int n_xoration);
+
+/**
+ * @brief unlocks the vault and retrieves key_pre, with soft votes
+ *
+ * This function behaves as unlock(), but weighs the vote of every lock
+ * by its log-likelihood ratio instead of counting it once. The error
+ * probability of a lock follows from the error probabilities in e_map
+ * of the source bits it XORs, so locks touching unstable bits barely
+ * count. A bit-locker decodes to 1 when the weight of the locks voting
+ * 1 exceeds the weight of those voting 0.
+ *
+ * @param source reference source
+ * @param source_indexes source indexes of the bit-lockers in
+ * key_indexes, n_locks * n_xoration per key bit
+ * @param vault reference vault
+ * @param key reference key
+ * @param key_indexes vault indexes to form the key
+ * @param key_bits key length in bits
+ * @param n_locks number of locks per bit-locker
+ * @param n_xoration number of bits per XOR-ation
+ * @param e_map error probability of every source bit, in 1/256
+ * @return void
+ * @see reliability_map
+ */
+void unlock_soft(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned char *vault,
+    unsigned char *key,
+    unsigned int *key_indexes,
+    unsigned int key_bits,
+    unsigned int n_locks,
+    unsigned int n_xoration,
+    unsigned char *e_map);
+
+/**
+ * @brief estimates the error probability of every source bit
+ *
+ * This function compares n_reads readings with the preferred source
+ * state and stores, for every bit, its estimated flip probability in
+ * 1/256, clamped to [1, 255]. The estimate adds half a flip to the
+ * counts, so that a bit is never deemed perfectly stable.
+ *
+ * @param source preferred source state
+ * @param reads n_reads readings from source
+ * @param n_reads number of readings, at most 65535
+ * @param size size of source and of every reading in bytes
+ * @param e_map storage for 8 * size error probabilities
+ * @return void
+ */
+void reliability_map(
+    unsigned char *source,
+    unsigned char **reads,
+    unsigned int n_reads,
+    int size,
+    unsigned char *e_map);
+
+/**
+ * @brief fuses readings into a preferred source state
+ *
+ * This function sets every source bit to the majority of its n_reads
+ * readings, ties going to 0 as in unlock(). If e_map is not NULL, it
+ * also stores the estimated flip probability of every bit against the
+ * majority, as reliability_map() does, ready for
+ * xlock_ctx_set_reliability(). Readings are counted 64 bits at a time
+ * in bit-sliced counters.
+ *
+ * @param reads n_reads readings from source
+ * @param n_reads number of readings, at most 65535
+ * @param size size of every reading in bytes
+ * @param source storage for the preferred source state
+ * @param e_map storage for 8 * size error probabilities, or NULL
+ * @return void
+ */
+void fuse_reads(
+    unsigned char **reads,
+    unsigned int n_reads,
+    int size,
+    unsigned char *source,
+    unsigned char *e_map);
+
+/**
+ * @brief builds the vault of a given source and pool
+ * 
+ * This function derives the source indexes from source_seed and locks
+ * pool into vault, lockers bit-lockers at a time, using source_indexes
+ * as scratch. Unlike init(), source and pool are left untouched.
+ *
+ * @param source preferred source state
+ * @param source_seed source seed for indexes to unlock vault
+ * @param source_bits source length in bits
+ * @param pool random pool
+ * @param pool_bits pool length in bits
+ * @param vault encrypted vault
+ * @param n_locks number of locks per bit-locker
+ * @param n_xoration number of bits per XOR-ation
+ * @param source_indexes scratch for lockers * n_locks * n_xoration indexes
+ * @param lockers number of bit-lockers locked at a time
+ * @return void
+ */
+void enroll(
+    unsigned char *source,
+    unsigned long *source_seed,
+    unsigned int source_bits,
+    unsigned char *pool,
+    unsigned int pool_bits,
+    unsigned char *vault,
+    unsigned int n_locks,
+    unsigned int n_xoration,
+    unsigned int *source_indexes,
+    unsigned int lockers);
+
+/**
+ * @brief lock_range() with 16-bit source indexes
+ *
+ * @see lock_range
+ * @note source_bits must be at most INDEX16_BITS.
+ */
+void lock_range16(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned char *pool,
+    unsigned int first,
+    unsigned int count,
+    unsigned int n_locks,
+    unsigned int n_xoration,
+    unsigned char *vault);
+
+/**
+ * @brief locker_indexes() with 16-bit indexes
+ *
+ * @see locker_indexes
+ * @note source_bits must be at most INDEX16_BITS.
+ */
+void locker_indexes16(
+    unsigned long *source_seed,
+    unsigned int source_bits,
+    uint16_t *key_indexes,
+    unsigned int key_bits,
+    unsigned int n_locks,
+    unsigned int n_xoration,
+    uint16_t *source_indexes);
+
+/**
+ * @brief unlock() with 16-bit indexes
+ *
+ * @see unlock
+ * @note source_bits must be at most INDEX16_BITS.
+ */
+void unlock16(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned char *vault,
+    unsigned char *key,
+    uint16_t *key_indexes,
+    unsigned int key_bits,
+    unsigned int n_locks,
+    unsigned int n_xoration);
+
+/**
+ * @brief unlock_early() with 16-bit indexes
+ *
+ * @see unlock_early
+ * @note source_bits must be at most INDEX16_BITS.
+ */
+unsigned long unlock_early16(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned char *vault,
+    unsigned char *key,
+    uint16_t *key_indexes,
+    unsigned int key_bits,
+    unsigned int n_locks,
+    unsigned int n_xoration);
+
+/**
+ * @brief unlock_soft() with 16-bit indexes
+ *
+ * @see unlock_soft
+ * @note source_bits must be at most INDEX16_BITS.
+ */
+void unlock_soft16(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned char *vault,
+    unsigned char *key,
+    uint16_t *key_indexes,
+    unsigned int key_bits,
+    unsigned int n_locks,
+    unsigned int n_xoration,
+    unsigned char *e_map);
+
+/**
+ * @brief enroll() with 16-bit source indexes
+ *
+ * @see enroll
+ * @note source_bits must be at most INDEX16_BITS.
+ */
+void enroll16(
+    unsigned char *source,
+    unsigned long *source_seed,
+    unsigned int source_bits,
+    unsigned char *pool,
+    unsigned int pool_bits,
+    unsigned char *vault,
+    unsigned int n_locks,
+    unsigned int n_xoration,
+    uint16_t *source_indexes,
+    unsigned int lockers);
+
 /**
  * @brief initializes source, pool and vault
  * 
@@ -157,9 +568,12 @@ void init(
  * @param pool_bits pool length in bits
  * @param n_locks number of locks per bit-locker
  * @param n_xoration number of bits per XOR-ation
- * @return either 0 or the time in milliseconds
+ * @return a negative value if parameters are invalid, memory is short
+ * or no nonce could be generated, either 0 or the time in milliseconds
  * @note if seeds are not specified or are 0, the function
  * initializes them
+ * @note the scratch memory is allocated on the heap at every call.
+ * @see xlock_ctx_gen to reuse scratch memory across calls
  */
 double gen(
     unsigned char *read,
@@ -201,7 +615,10 @@ double gen(
  * @param pool_bits pool length in bits
  * @param n_locks number of locks per bit-locker
  * @param n_xoration number of bits per XOR-ation
- * @return either 0 or the time in milliseconds
+ * @return a negative value if parameters are invalid or memory is
+ * short, either 0 or the time in milliseconds
+ * @note the scratch memory is allocated on the heap at every call.
+ * @see xlock_ctx_rep to reuse scratch memory across calls
  */
 double rep(
     unsigned char *read,
@@ -0,0 +1,239 @@
+/**
+ * @file batch.c
+ * @brief Batch reproduction across a worker pool
+ *
+ * This file implements the worker pool of X-Lock.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../include/bits.h"
+#include "../include/context.h"
+#include "../include/batch.h"
+
+/**
+ * @brief alignment of the scratch memory of a worker
+ *
+ * Scratch memory is kept on distinct cache lines so that workers do
+ * not falsely share them.
+ */
+#define BATCH_ALIGN 64
+
+/**
+ * @brief Returns n rounded up to a multiple of BATCH_ALIGN.
+ */
+#define BATCH_ROUND(n) (((n) + BATCH_ALIGN - 1) / BATCH_ALIGN * BATCH_ALIGN)
+
+/**
+ * @brief reproduces or enrolls the devices of the current batch
+ *
+ * @param worker worker
+ * @param batch batch in progress
+ * @return void
+ */
+void xlock_worker_run(struct xlock_worker *worker, struct xlock_batch *batch)
+{
+    struct xlock_pool *pool = worker->pool;
+    unsigned int key_bytes = bits_to_bytes(pool->params.key_bits);
+    unsigned int i;
+
+    while ((i = __atomic_fetch_add(&pool->next, 1, __ATOMIC_RELAXED)) < batch->n)
+    {
+        if (pool->gen)
+        {
+            batch->ok[i] = !xlock_ctx_enroll(
+                               &worker->ctx, batch->reads[i], &batch->source_seeds[i],
+                               batch->pools[i], batch->vaults[i]) &&
+                           !xlock_ctx_gen(
+                               &worker->ctx, batch->reads[i], &batch->source_seeds[i],
+                               batch->vaults[i], batch->keys + (size_t)i * key_bytes,
+                               &batch->key_seeds[i], &batch->nonces[i], batch->tokens[i]);
+            continue;
+        }
+        batch->ok[i] = !xlock_ctx_rep(
+            &worker->ctx, batch->reads[i], &batch->source_seeds[i],
+            batch->vaults[i], batch->keys + (size_t)i * key_bytes,
+            &batch->key_seeds[i], &batch->nonces[i], batch->tokens[i]);
+    }
+}
+
+/**
+ * @brief main loop of a worker thread
+ *
+ * @param arg worker
+ * @return NULL
+ */
+void *xlock_worker_main(void *arg)
+{
+    struct xlock_worker *worker = arg;
+    struct xlock_pool *pool = worker->pool;
+    struct xlock_batch *batch;
+    unsigned long round = 0;
+
+    pthread_mutex_lock(&pool->lock);
+    for (;;)
+    {
+        while (!pool->stop && pool->round == round)
+            pthread_cond_wait(&pool->work, &pool->lock);
+        if (pool->stop)
+            break;
+        round = pool->round;
+        batch = pool->batch;
+        pthread_mutex_unlock(&pool->lock);
+
+        xlock_worker_run(worker, batch);
+
+        pthread_mutex_lock(&pool->lock);
+        if (--pool->active == 0)
+            pthread_cond_signal(&pool->done);
+    }
+    pthread_mutex_unlock(&pool->lock);
+
+    return NULL;
+}
+
+int xlock_pool_init(struct xlock_pool *pool, struct xlock_params *params, unsigned int n_workers)
+{
+    size_t size;
+    unsigned int i;
+    long cpus;
+
+    /* invalid parameters may ask for absurd sizes */
+    if (xlock_params_check(params))
+        return -1;
+    size = BATCH_ROUND(xlock_ctx_size(params));
+
+    if (!n_workers)
+    {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_workers = cpus > 0 ? (unsigned int)cpus : 1;
+    }
+    if (n_workers > SIZE_MAX / size)
+    {
+#ifdef _DEBUG_
+        printf("error: scratch of %u workers overflows\n", n_workers);
+#endif
+        return -1;
+    }
+
+    memset(pool, 0, sizeof(struct xlock_pool));
+    pool->params = *params;
+    pool->workers = calloc(n_workers, sizeof(struct xlock_worker));
+    pool->scratch = aligned_alloc(BATCH_ALIGN, (size_t)n_workers * size);
+    if (!pool->workers || !pool->scratch)
+    {
+#ifdef _DEBUG_
+        printf("error: cannot allocate %u workers\n", n_workers);
+#endif
+        free(pool->workers);
+        free(pool->scratch);
+        return -1;
+    }
+
+    for (i = 0; i < n_workers; i++)
+    {
+        pool->workers[i].pool = pool;
+        if (xlock_ctx_init(&pool->workers[i].ctx, params, pool->scratch + i * size, size))
+        {
+            free(pool->workers);
+            free(pool->scratch);
+            return -1;
+        }
+    }
+
+    pthread_mutex_init(&pool->submit, NULL);
+    pthread_mutex_init(&pool->lock, NULL);
+    pthread_cond_init(&pool->work, NULL);
+    pthread_cond_init(&pool->done, NULL);
+
+    /* start the workers, keeping those already running on failure */
+    for (i = 0; i < n_workers; i++)
+    {
+        if (pthread_create(&pool->workers[i].thread, NULL, xlock_worker_main, &pool->workers[i]))
+            break;
+        pool->n_workers++;
+    }
+    if (pool->n_workers < n_workers)
+    {
+#ifdef _DEBUG_
+        printf("error: cannot start worker %u\n", pool->n_workers);
+#endif
+        xlock_pool_free(pool);
+        return -1;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief runs a batch on the workers
+ *
+ * @param pool pool
+ * @param batch devices of the batch
+ * @param gen 1 to enroll and generate, 0 to reproduce
+ * @return the number of devices whose flag is set
+ */
+unsigned int xlock_pool_run(struct xlock_pool *pool, struct xlock_batch *batch, int gen)
+{
+    unsigned int i, done = 0;
+
+    pthread_mutex_lock(&pool->submit);
+
+    pthread_mutex_lock(&pool->lock);
+    pool->batch = batch;
+    pool->gen = gen;
+    pool->next = 0;
+    pool->active = pool->n_workers;
+    pool->round++;
+    pthread_cond_broadcast(&pool->work);
+    while (pool->active)
+        pthread_cond_wait(&pool->done, &pool->lock);
+    pool->batch = NULL;
+    pthread_mutex_unlock(&pool->lock);
+
+    pthread_mutex_unlock(&pool->submit);
+
+    for (i = 0; i < batch->n; i++)
+        done += batch->ok[i];
+
+    return done;
+}
+
+unsigned int xlock_pool_rep(struct xlock_pool *pool, struct xlock_batch *batch)
+{
+    return xlock_pool_run(pool, batch, 0);
+}
+
+unsigned int xlock_pool_gen(struct xlock_pool *pool, struct xlock_batch *batch)
+{
+    return xlock_pool_run(pool, batch, 1);
+}
+
+void xlock_pool_free(struct xlock_pool *pool)
+{
+    unsigned int i;
+
+    pthread_mutex_lock(&pool->lock);
+    pool->stop = 1;
+    pthread_cond_broadcast(&pool->work);
+    pthread_mutex_unlock(&pool->lock);
+
+    for (i = 0; i < pool->n_workers; i++)
+        pthread_join(pool->workers[i].thread, NULL);
+
+    pthread_cond_destroy(&pool->done);
+    pthread_cond_destroy(&pool->work);
+    pthread_mutex_destroy(&pool->lock);
+    pthread_mutex_destroy(&pool->submit);
+
+    free(pool->workers);
+    free(pool->scratch);
+    pool->workers = NULL;
+    pool->scratch = NULL;
+    pool->n_workers = 0;
+}
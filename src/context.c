@@ -0,0 +1,774 @@
+/**
+ * @file context.c
+ * @brief Reusable X-Lock contexts
+ *
+ * This file implements the context API of X-Lock.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include "../include/bits.h"
+#include "../include/hmac.h"
+#include "../include/indexes.h"
+#include "../include/xlock.h"
+#include "../include/context.h"
+#include "../include/plan.h"
+#include "../include/stats.h"
+#include "../include/stable.h"
+
+/**
+ * @brief alignment of the scratch arrays
+ */
+#define CTX_ALIGN 16
+
+/**
+ * @brief Returns n rounded up to a multiple of CTX_ALIGN.
+ */
+#define CTX_ROUND(n) (((n) + CTX_ALIGN - 1) / CTX_ALIGN * CTX_ALIGN)
+
+unsigned int xlock_index_bytes(struct xlock_params *params)
+{
+    return params->source_bits <= INDEX16_BITS ? sizeof(uint16_t) : sizeof(unsigned int);
+}
+
+unsigned int xlock_index_get(unsigned int index_bytes, void *indexes, unsigned int i)
+{
+    return index_bytes == sizeof(uint16_t) ? ((uint16_t *)indexes)[i] : ((unsigned int *)indexes)[i];
+}
+
+/**
+ * @brief stores the ith index
+ *
+ * @param index_bytes width of the stored indexes
+ * @param indexes stored indexes
+ * @param i position of the index
+ * @param v value of the index
+ * @return void
+ */
+void xlock_index_set(unsigned int index_bytes, void *indexes, unsigned int i, unsigned int v)
+{
+    if (index_bytes == sizeof(uint16_t))
+        ((uint16_t *)indexes)[i] = (uint16_t)v;
+    else
+        ((unsigned int *)indexes)[i] = v;
+}
+
+/**
+ * @brief derives the key indexes of a key seed
+ *
+ * @param params X-Lock parameters
+ * @param key_seed key seed for indexes that form the key
+ * @param key_indexes storage for key_pre_bits indexes
+ * @return void
+ * @note if key_seed is not specified or is 0, it is initialized.
+ */
+void xlock_key_indexes(struct xlock_params *params, unsigned long *key_seed, void *key_indexes)
+{
+    /* key indexes are the head of a permutation of the pool */
+    if (xlock_index_bytes(params) == sizeof(uint16_t))
+        prng_rand_permutation16(key_seed, 0, params->key_pre_bits, key_indexes, 0, params->pool_bits);
+    else
+        prng_rand_without_replacement(key_seed, params->key_pre_bits, key_indexes, 0, params->pool_bits);
+}
+
+/**
+ * @brief maps ranks among the stable bits to source positions
+ *
+ * @param index_bytes width of the stored indexes
+ * @param stable rank/select structure over the stable bits
+ * @param indexes n ranks, replaced by their source positions
+ * @param n number of indexes
+ * @return void
+ */
+void xlock_stable_indexes(unsigned int index_bytes, struct xlock_stable *stable, void *indexes, size_t n)
+{
+    size_t i;
+
+    for (i = 0; i < n; i++)
+    {
+        xlock_index_set(index_bytes, indexes, i, xlock_stable_select(stable, xlock_index_get(index_bytes, indexes, i)));
+    }
+}
+
+/**
+ * @brief derives the source indexes of count bit-lockers
+ *
+ * @param params X-Lock parameters
+ * @param stable stable bits to draw from, or NULL for every source bit
+ * @param source_seed source seed for indexes to unlock vault
+ * @param key_indexes indexes of the bit-lockers
+ * @param count number of bit-lockers
+ * @param source_indexes storage for count * n_locks * n_xoration indexes
+ * @return void
+ * @note if source_seed is not specified or is 0, it is initialized.
+ */
+void xlock_locker_indexes(
+    struct xlock_params *params,
+    struct xlock_stable *stable,
+    unsigned long *source_seed,
+    void *key_indexes,
+    unsigned int count,
+    void *source_indexes)
+{
+    unsigned int source_bits = stable ? stable->n_stable : params->source_bits;
+
+    if (xlock_index_bytes(params) == sizeof(uint16_t))
+        locker_indexes16(
+            source_seed, source_bits, key_indexes, count,
+            params->n_locks, params->n_xoration, source_indexes);
+    else
+        locker_indexes(
+            source_seed, source_bits, key_indexes, count,
+            params->n_locks, params->n_xoration, source_indexes);
+
+    if (stable)
+        xlock_stable_indexes(
+            xlock_index_bytes(params), stable, source_indexes,
+            (size_t)count * params->n_locks * params->n_xoration);
+}
+
+void xlock_indexes(
+    struct xlock_params *params,
+    unsigned long *source_seed,
+    unsigned long *key_seed,
+    void *key_indexes,
+    void *source_indexes)
+{
+    xlock_key_indexes(params, key_seed, key_indexes);
+    xlock_locker_indexes(params, NULL, source_seed, key_indexes, params->key_pre_bits, source_indexes);
+}
+
+int xlock_params_check(struct xlock_params *params)
+{
+    if (!params->n_locks || !params->n_xoration)
+    {
+#ifdef _DEBUG_
+        printf("error: n_locks or n_xoration is 0\n");
+#endif
+        return -1;
+    }
+
+    if (!params->key_pre_bits || params->key_pre_bits > params->pool_bits)
+    {
+#ifdef _DEBUG_
+        printf("error: key_pre_bits not in [1, pool_bits]\n");
+#endif
+        return -1;
+    }
+
+    /* divided rather than multiplied, so that no product wraps around */
+    if (params->source_bits < 32 || (uint64_t)params->n_locks * params->n_xoration > params->source_bits ||
+        params->pool_bits > params->source_bits / (params->n_locks * params->n_xoration))
+    {
+#ifdef _DEBUG_
+        printf("error: source_bits < max(32, pool_bits * n_locks * n_xoration)\n");
+#endif
+        return -1;
+    }
+
+    if (!params->key_bits || params->key_bits > bytes_to_bits(HMAC_BYTES) ||
+        !params->token_bytes || params->token_bytes > HMAC_BYTES)
+    {
+#ifdef _DEBUG_
+        printf("error: key_bits or token_bytes exceed the HMAC-SHA256 output\n");
+#endif
+        return -1;
+    }
+
+    return 0;
+}
+
+size_t xlock_ctx_size(struct xlock_params *params)
+{
+    size_t lockers = params->key_pre_bits;
+    size_t di = (size_t)params->n_locks * params->n_xoration;
+
+    return CTX_ALIGN - 1 +
+           CTX_ROUND(lockers * di * xlock_index_bytes(params)) +
+           CTX_ROUND(lockers * xlock_index_bytes(params)) +
+           2 * CTX_ROUND(bits_to_bytes(params->pool_bits)) +
+           CTX_ROUND(bits_to_bytes(params->key_pre_bits)) +
+           CTX_ROUND(params->token_bytes);
+}
+
+int xlock_ctx_init(struct xlock_ctx *ctx, struct xlock_params *params, void *buf, size_t size)
+{
+    unsigned char *p;
+    size_t di = (size_t)params->n_locks * params->n_xoration;
+
+    if (xlock_params_check(params))
+        return -1;
+
+    if (!buf || size < xlock_ctx_size(params))
+    {
+#ifdef _DEBUG_
+        printf("error: scratch buffer smaller than %zu bytes\n", xlock_ctx_size(params));
+#endif
+        return -1;
+    }
+
+    ctx->params = *params;
+    ctx->plans = NULL;
+    ctx->early_exit = 0;
+    ctx->e_map = NULL;
+    ctx->stable = NULL;
+    ctx->lockers = 0;
+    ctx->locks_skipped = 0;
+
+    p = (unsigned char *)CTX_ROUND((uintptr_t)buf);
+    ctx->index_bytes = xlock_index_bytes(params);
+    ctx->source_indexes = p;
+    p += CTX_ROUND(params->key_pre_bits * di * ctx->index_bytes);
+    ctx->key_indexes = p;
+    p += CTX_ROUND(params->key_pre_bits * ctx->index_bytes);
+    ctx->pool = p;
+    p += CTX_ROUND(bits_to_bytes(params->pool_bits));
+    ctx->needed = p;
+    p += CTX_ROUND(bits_to_bytes(params->pool_bits));
+    ctx->key_pre = p;
+    p += CTX_ROUND(bits_to_bytes(params->key_pre_bits));
+    ctx->token = p;
+
+    return 0;
+}
+
+int xlock_ctx_set_plan_cache(struct xlock_ctx *ctx, struct plan_cache *cache)
+{
+    if (cache && memcmp(&cache->params, &ctx->params, sizeof(struct xlock_params)))
+        return -1;
+
+    ctx->plans = cache;
+    return 0;
+}
+
+void xlock_ctx_set_early_exit(struct xlock_ctx *ctx, int enable)
+{
+    ctx->early_exit = enable;
+}
+
+void xlock_ctx_set_reliability(struct xlock_ctx *ctx, unsigned char *e_map)
+{
+    ctx->e_map = e_map;
+}
+
+int xlock_ctx_set_stable(struct xlock_ctx *ctx, struct xlock_stable *stable)
+{
+    struct xlock_params *params = &ctx->params;
+
+    if (stable && (stable->source_bits != params->source_bits ||
+                   stable->n_stable < params->pool_bits * params->n_locks * params->n_xoration))
+    {
+#ifdef _DEBUG_
+        printf("error: stable bits do not cover pool_bits * n_locks * n_xoration indexes\n");
+#endif
+        return -1;
+    }
+    if (stable && stable->span > XLOCK_STABLE_SPAN)
+    {
+#ifdef _DEBUG_
+        printf("error: stable bits too sparse, select spans %u words\n", stable->span);
+#endif
+        return -1;
+    }
+
+    ctx->stable = stable;
+    return 0;
+}
+
+double xlock_ctx_mean_skipped(struct xlock_ctx *ctx)
+{
+    return ctx->lockers ? (double)ctx->locks_skipped / ctx->lockers : 0;
+}
+
+int xlock_ctx_enroll(
+    struct xlock_ctx *ctx,
+    unsigned char *source,
+    unsigned long *source_seed,
+    unsigned char *pool,
+    unsigned char *vault)
+{
+    struct xlock_params *params = &ctx->params;
+    size_t di = (size_t)params->n_locks * params->n_xoration;
+    unsigned int i, count;
+
+    /* the index scratch holds key_pre_bits bit-lockers at a time */
+    if (ctx->stable)
+    {
+        /* as enroll() does, drawing ranks among the stable bits */
+        for (i = 0; i < params->pool_bits; i += count)
+        {
+            count = params->pool_bits - i < params->key_pre_bits ? params->pool_bits - i : params->key_pre_bits;
+            if (ctx->index_bytes == sizeof(uint16_t))
+                prng_rand_permutation16(source_seed, i * di, count * di, ctx->source_indexes, 0, ctx->stable->n_stable);
+            else
+                prng_rand_permutation(source_seed, i * di, count * di, ctx->source_indexes, 0, ctx->stable->n_stable);
+            xlock_stable_indexes(ctx->index_bytes, ctx->stable, ctx->source_indexes, count * di);
+
+            if (ctx->index_bytes == sizeof(uint16_t))
+                lock_range16(source, ctx->source_indexes, pool, i, count, params->n_locks, params->n_xoration, vault);
+            else
+                lock_range(source, ctx->source_indexes, pool, i, count, params->n_locks, params->n_xoration, vault);
+        }
+    }
+    else if (ctx->index_bytes == sizeof(uint16_t))
+        enroll16(
+            source, source_seed, params->source_bits,
+            pool, params->pool_bits, vault,
+            params->n_locks, params->n_xoration,
+            ctx->source_indexes, params->key_pre_bits);
+    else
+        enroll(
+            source, source_seed, params->source_bits,
+            pool, params->pool_bits, vault,
+            params->n_locks, params->n_xoration,
+            ctx->source_indexes, params->key_pre_bits);
+
+    return 0;
+}
+
+/**
+ * @brief unlocks count bit-lockers
+ *
+ * This function votes the bit-lockers in the width of the context,
+ * with soft votes or early exit if enabled, and stores their bits in
+ * key.
+ *
+ * @param ctx context
+ * @param read reading from source
+ * @param vault encrypted vault
+ * @param key_indexes indexes of the bit-lockers
+ * @param source_indexes source indexes of the bit-lockers
+ * @param count number of bit-lockers
+ * @param key storage for count bits
+ * @return void
+ */
+void xlock_ctx_unlock(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned char *vault,
+    void *key_indexes,
+    void *source_indexes,
+    unsigned int count,
+    unsigned char *key)
+{
+    struct xlock_params *params = &ctx->params;
+    struct xlock_probe probe;
+    unsigned long skipped = 0;
+
+    xlock_probe_start(&probe);
+    if (ctx->e_map)
+    {
+        if (ctx->index_bytes == sizeof(uint16_t))
+            unlock_soft16(
+                read, source_indexes, vault, key, key_indexes, count,
+                params->n_locks, params->n_xoration, ctx->e_map);
+        else
+            unlock_soft(
+                read, source_indexes, vault, key, key_indexes, count,
+                params->n_locks, params->n_xoration, ctx->e_map);
+    }
+    else if (ctx->index_bytes == sizeof(uint16_t))
+    {
+        if (ctx->early_exit)
+            skipped = unlock_early16(
+                read, source_indexes, vault, key, key_indexes, count,
+                params->n_locks, params->n_xoration);
+        else
+            unlock16(
+                read, source_indexes, vault, key, key_indexes, count,
+                params->n_locks, params->n_xoration);
+    }
+    else
+    {
+        if (ctx->early_exit)
+            skipped = unlock_early(
+                read, source_indexes, vault, key, key_indexes, count,
+                params->n_locks, params->n_xoration);
+        else
+            unlock(
+                read, source_indexes, vault, key, key_indexes, count,
+                params->n_locks, params->n_xoration);
+    }
+    xlock_probe_stop(&probe, XLOCK_PHASE_UNLOCK);
+
+    if (ctx->early_exit && !ctx->e_map)
+    {
+        ctx->locks_skipped += skipped;
+        ctx->lockers += count;
+    }
+}
+
+/**
+ * @brief retrieves key_pre from the vault
+ *
+ * This function derives the indexes of the bit-lockers forming key_pre
+ * and unlocks them into ctx->key_pre.
+ *
+ * @param ctx context
+ * @param read reading from source
+ * @param source_seed source seed for indexes to unlock vault
+ * @param vault encrypted vault
+ * @param key_seed key seed for indexes that form the key
+ * @return the key indexes of key_pre
+ */
+void *xlock_ctx_key_pre(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned long *key_seed)
+{
+    struct xlock_params *params = &ctx->params;
+    void *key_indexes = ctx->key_indexes, *source_indexes = ctx->source_indexes;
+    struct xlock_probe probe;
+
+    xlock_probe_start(&probe);
+    if (ctx->plans && !ctx->stable && source_seed && *source_seed && key_seed && *key_seed)
+    {
+        /* reuse the cached indexes of the seed pair */
+        key_indexes = plan_cache_get(ctx->plans, *source_seed, *key_seed);
+        source_indexes = (unsigned char *)key_indexes + params->key_pre_bits * ctx->index_bytes;
+    }
+    else
+    {
+        /* generate sets of indexes, only for the bit-lockers forming key_pre */
+        xlock_key_indexes(params, key_seed, key_indexes);
+        xlock_locker_indexes(params, ctx->stable, source_seed, key_indexes, params->key_pre_bits, source_indexes);
+    }
+    xlock_probe_stop(&probe, XLOCK_PHASE_INDEXES);
+
+    /* generate key_pre */
+    xlock_ctx_unlock(ctx, read, vault, key_indexes, source_indexes, params->key_pre_bits, ctx->key_pre);
+
+    return key_indexes;
+}
+
+unsigned int xlock_ctx_key_pre_errors(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned long *key_seed,
+    unsigned char *pool)
+{
+    struct xlock_params *params = &ctx->params;
+    void *key_indexes;
+    unsigned int i, errors = 0;
+
+    key_indexes = xlock_ctx_key_pre(ctx, read, source_seed, vault, key_seed);
+
+    for (i = 0; i < params->key_pre_bits; i++)
+    {
+        errors += get_bit(ctx->key_pre, i) != get_bit(pool, xlock_index_get(ctx->index_bytes, key_indexes, i));
+    }
+
+    return errors;
+}
+
+/**
+ * @brief unlocks the union of the bit-lockers of several keys
+ *
+ * This function marks the bit-lockers selected by every key seed, then
+ * unlocks each marked bit-locker once into ctx->pool, key_pre_bits
+ * bit-lockers at a time.
+ *
+ * @param ctx context
+ * @param read reading from source
+ * @param source_seed source seed for indexes to unlock vault
+ * @param vault encrypted vault
+ * @param n_keys number of keys
+ * @param key_seeds n_keys key seeds
+ * @return void
+ */
+void xlock_ctx_pool_multi(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned int n_keys,
+    unsigned long *key_seeds)
+{
+    struct xlock_params *params = &ctx->params;
+    struct xlock_probe probe;
+    unsigned int i, k, count = 0;
+
+    /* mark the union of the bit-lockers */
+    xlock_probe_start(&probe);
+    memset(ctx->needed, 0, bits_to_bytes(params->pool_bits));
+    for (k = 0; k < n_keys; k++)
+    {
+        xlock_key_indexes(params, &key_seeds[k], ctx->key_indexes);
+        for (i = 0; i < params->key_pre_bits; i++)
+        {
+            set_bit_v(ctx->needed, xlock_index_get(ctx->index_bytes, ctx->key_indexes, i), 1);
+        }
+    }
+    xlock_probe_stop(&probe, XLOCK_PHASE_INDEXES);
+
+    /* unlock each marked bit-locker once */
+    for (i = 0; i < params->pool_bits; i++)
+    {
+        if (get_bit(ctx->needed, i))
+            xlock_index_set(ctx->index_bytes, ctx->key_indexes, count++, i);
+        if (count && (count == params->key_pre_bits || i == params->pool_bits - 1))
+        {
+            xlock_probe_start(&probe);
+            xlock_locker_indexes(params, ctx->stable, source_seed, ctx->key_indexes, count, ctx->source_indexes);
+            xlock_probe_stop(&probe, XLOCK_PHASE_INDEXES);
+            xlock_ctx_unlock(ctx, read, vault, ctx->key_indexes, ctx->source_indexes, count, ctx->key_pre);
+            for (k = 0; k < count; k++)
+            {
+                set_bit_v(ctx->pool, xlock_index_get(ctx->index_bytes, ctx->key_indexes, k), get_bit(ctx->key_pre, k));
+            }
+            count = 0;
+        }
+    }
+}
+
+/**
+ * @brief gathers the key_pre of a key seed from ctx->pool
+ *
+ * @param ctx context
+ * @param key_seed key seed for indexes that form the key
+ * @return void
+ */
+void xlock_ctx_key_pre_pool(struct xlock_ctx *ctx, unsigned long *key_seed)
+{
+    struct xlock_probe probe;
+    unsigned int i;
+
+    xlock_probe_start(&probe);
+    xlock_key_indexes(&ctx->params, key_seed, ctx->key_indexes);
+    xlock_probe_stop(&probe, XLOCK_PHASE_INDEXES);
+    for (i = 0; i < ctx->params.key_pre_bits; i++)
+    {
+        set_bit_v(ctx->key_pre, i, get_bit(ctx->pool, xlock_index_get(ctx->index_bytes, ctx->key_indexes, i)));
+    }
+}
+
+/**
+ * @brief derives the final key and the robustness token
+ *
+ * This function computes key = hash(key_pre, nonce) and
+ * token = hash(key, key_seed), truncated to their lengths.
+ *
+ * @param ctx context
+ * @param key key storage
+ * @param key_seed key seed for indexes that form the key
+ * @param nonce nonce for final key generation
+ * @param token robustness token storage
+ * @return 0 on success, -1 if HMAC failed
+ */
+int xlock_ctx_key_token(
+    struct xlock_ctx *ctx,
+    unsigned char *key,
+    unsigned long *key_seed,
+    unsigned long *nonce,
+    unsigned char *token)
+{
+    unsigned char md[HMAC_BYTES];
+    struct xlock_params *params = &ctx->params;
+    struct xlock_probe probe;
+
+    /* key = hash(key_pre, noce) */
+    xlock_probe_start(&probe);
+    if (hmac_sha256((unsigned char *)nonce, sizeof(unsigned long), ctx->key_pre, bits_to_bytes(params->key_pre_bits), md))
+        return -1;
+    memcpy(key, md, bits_to_bytes(params->key_bits));
+    xlock_probe_stop(&probe, XLOCK_PHASE_KEY);
+
+    /* token = hash(key, key_seed) */
+    xlock_probe_start(&probe);
+    if (hmac_sha256((unsigned char *)key_seed, sizeof(unsigned long), key, bits_to_bytes(params->key_bits), md))
+        return -1;
+    memcpy(token, md, params->token_bytes);
+    xlock_probe_stop(&probe, XLOCK_PHASE_TOKEN);
+
+    return 0;
+}
+
+/**
+ * @brief derives the final key and checks it against a token
+ *
+ * @param ctx context
+ * @param key key storage
+ * @param key_seed key seed for indexes that form the key
+ * @param nonce nonce for final key generation
+ * @param token robustness token
+ * @return 0 if the computed token matches token, -1 otherwise
+ * @note on failure, key is nullified.
+ */
+int xlock_ctx_check(
+    struct xlock_ctx *ctx,
+    unsigned char *key,
+    unsigned long *key_seed,
+    unsigned long *nonce,
+    unsigned char *token)
+{
+    unsigned int i;
+    unsigned char diff = 0;
+
+    if (xlock_ctx_key_token(ctx, key, key_seed, nonce, ctx->token))
+    {
+        memset(key, 0, bits_to_bytes(ctx->params.key_bits));
+        return -1;
+    }
+
+    /* check if T != T', in constant time */
+    for (i = 0; i < ctx->params.token_bytes; i++)
+    {
+        diff |= ctx->token[i] ^ token[i];
+    }
+    if (diff)
+    {
+#ifdef _VERBOSE_
+        printf("T != computed T\n");
+#endif
+        memset(key, 0, bits_to_bytes(ctx->params.key_bits));
+        return -1;
+    }
+
+    return 0;
+}
+
+int xlock_ctx_gen(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned char *key,
+    unsigned long *key_seed,
+    unsigned long *nonce,
+    unsigned char *token)
+{
+    xlock_ctx_key_pre(ctx, read, source_seed, vault, key_seed);
+
+#ifdef _VERBOSE_
+    printf("key pre gen (%u bytes)\t\t\t: ", bits_to_bytes(ctx->params.key_pre_bits));
+    for (unsigned int i = 0; i < bits_to_bytes(ctx->params.key_pre_bits); i++)
+    {
+        printf("%x", ctx->key_pre[i]);
+    }
+    printf("\n");
+#endif
+
+    /* generate nonce for final key, without touching the global rand() state */
+    if (random_bytes((unsigned char *)nonce, sizeof(unsigned long)))
+    {
+#ifdef _DEBUG_
+        printf("error: nonce generation failed\n");
+#endif
+        return -1;
+    }
+
+    if (xlock_ctx_key_token(ctx, key, key_seed, nonce, token))
+        return -1;
+
+#ifdef _VERBOSE_
+    printf("robustness token (%u bytes)\t\t: ", ctx->params.token_bytes);
+    for (unsigned int i = 0; i < ctx->params.token_bytes; i++)
+    {
+        printf("%x", token[i]);
+    }
+    printf("\n");
+#endif
+
+    return 0;
+}
+
+int xlock_ctx_rep(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned char *key,
+    unsigned long *key_seed,
+    unsigned long *nonce,
+    unsigned char *token)
+{
+    xlock_ctx_key_pre(ctx, read, source_seed, vault, key_seed);
+
+#ifdef _VERBOSE_
+    printf("key pre rep (%u bytes)\t\t\t: ", bits_to_bytes(ctx->params.key_pre_bits));
+    for (unsigned int i = 0; i < bits_to_bytes(ctx->params.key_pre_bits); i++)
+    {
+        printf("%x", ctx->key_pre[i]);
+    }
+    printf("\n");
+#endif
+
+    return xlock_ctx_check(ctx, key, key_seed, nonce, token);
+}
+
+int xlock_ctx_gen_multi(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned int n_keys,
+    unsigned char *keys,
+    unsigned long *key_seeds,
+    unsigned long *nonces,
+    unsigned char *tokens)
+{
+    unsigned int k;
+    unsigned int key_bytes = bits_to_bytes(ctx->params.key_bits);
+
+    xlock_ctx_pool_multi(ctx, read, source_seed, vault, n_keys, key_seeds);
+
+    /* generate nonces for final keys */
+    if (random_bytes((unsigned char *)nonces, n_keys * sizeof(unsigned long)))
+    {
+#ifdef _DEBUG_
+        printf("error: nonce generation failed\n");
+#endif
+        return -1;
+    }
+
+    for (k = 0; k < n_keys; k++)
+    {
+        xlock_ctx_key_pre_pool(ctx, &key_seeds[k]);
+        if (xlock_ctx_key_token(
+                ctx, keys + k * key_bytes, &key_seeds[k], &nonces[k],
+                tokens + k * ctx->params.token_bytes))
+            return -1;
+    }
+
+    return 0;
+}
+
+int xlock_ctx_rep_multi(
+    struct xlock_ctx *ctx,
+    unsigned char *read,
+    unsigned long *source_seed,
+    unsigned char *vault,
+    unsigned int n_keys,
+    unsigned char *keys,
+    unsigned long *key_seeds,
+    unsigned long *nonces,
+    unsigned char *tokens,
+    int *ok)
+{
+    unsigned int k;
+    unsigned int key_bytes = bits_to_bytes(ctx->params.key_bits);
+    int res, failed = 0;
+
+    xlock_ctx_pool_multi(ctx, read, source_seed, vault, n_keys, key_seeds);
+
+    for (k = 0; k < n_keys; k++)
+    {
+        xlock_ctx_key_pre_pool(ctx, &key_seeds[k]);
+        res = xlock_ctx_check(
+            ctx, keys + k * key_bytes, &key_seeds[k], &nonces[k],
+            tokens + k * ctx->params.token_bytes);
+        if (ok)
+            ok[k] = !res;
+        failed |= res;
+    }
+
+    return failed ? -1 : 0;
+}
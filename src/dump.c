@@ -0,0 +1,197 @@
+/**
+ * @file dump.c
+ * @brief Streaming reader of recorded source readings
+ *
+ * This file implements the dump reader of X-Lock. The loading thread
+ * alternates between the two buffers, and waits for the caller to
+ * release a buffer before refilling it.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <pthread.h>
+#include <sys/stat.h>
+
+#include "../include/dump.h"
+
+/**
+ * @brief loads readings from the file
+ *
+ * @param dump reader
+ * @param b buffer
+ * @param first first reading to load
+ * @param n number of readings to load
+ * @return 0 on success, -1 if the file could not be read
+ */
+int dump_load(struct xlock_dump *dump, unsigned char *b, uint64_t first, unsigned int n)
+{
+    size_t size = (size_t)n * dump->read_bytes;
+    off_t pos = dump->offset + first * dump->read_bytes;
+    ssize_t r;
+
+    while (size)
+    {
+        r = pread(dump->fd, b, size, pos);
+        if (r < 0 && errno == EINTR)
+            continue;
+        if (r <= 0)
+        {
+#ifdef _DEBUG_
+            printf("error: cannot read dump at offset %lld\n", (long long)pos);
+#endif
+            return -1;
+        }
+        b += r;
+        pos += r;
+        size -= r;
+    }
+
+    return 0;
+}
+
+/**
+ * @brief main loop of the loading thread
+ *
+ * The thread exits after loading the empty chunk that marks the end of
+ * the file, or when it is stopped.
+ *
+ * @param arg reader
+ * @return NULL
+ */
+void *dump_main(void *arg)
+{
+    struct xlock_dump *dump = arg;
+    unsigned int b = 0, n;
+    int ret;
+
+    pthread_mutex_lock(&dump->lock);
+    for (;;)
+    {
+        while (dump->ready[b] && !dump->stop)
+            pthread_cond_wait(&dump->cond, &dump->lock);
+        if (dump->stop)
+            break;
+
+        /* next is only written by this thread, the buffer is ours */
+        pthread_mutex_unlock(&dump->lock);
+        n = dump->n_reads - dump->next < dump->chunk_reads ? dump->n_reads - dump->next : dump->chunk_reads;
+        ret = n ? dump_load(dump, dump->buf[b], dump->next, n) : 0;
+        pthread_mutex_lock(&dump->lock);
+
+        if (ret)
+        {
+            dump->error = 1;
+            n = 0;
+        }
+        dump->next += n;
+        dump->filled[b] = n;
+        dump->ready[b] = 1;
+        pthread_cond_broadcast(&dump->cond);
+        if (!n)
+            break;
+        b ^= 1;
+    }
+    pthread_mutex_unlock(&dump->lock);
+
+    return NULL;
+}
+
+int xlock_dump_open(
+    struct xlock_dump *dump,
+    const char *path,
+    uint64_t offset,
+    size_t read_bytes,
+    unsigned int chunk_reads)
+{
+    struct stat st;
+
+    memset(dump, 0, sizeof(struct xlock_dump));
+    if (!read_bytes || !chunk_reads)
+        return -1;
+
+    dump->fd = open(path, O_RDONLY);
+    if (dump->fd < 0)
+    {
+#ifdef _DEBUG_
+        printf("error: cannot open dump %s\n", path);
+#endif
+        return -1;
+    }
+
+    if (fstat(dump->fd, &st))
+        goto err_fd;
+
+    dump->read_bytes = read_bytes;
+    dump->offset = offset;
+    dump->n_reads = (uint64_t)st.st_size > offset ? ((uint64_t)st.st_size - offset) / read_bytes : 0;
+    dump->chunk_reads = chunk_reads;
+
+    /* the file is read once, front to back */
+    posix_fadvise(dump->fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+
+    dump->buf[0] = malloc((size_t)chunk_reads * read_bytes);
+    dump->buf[1] = malloc((size_t)chunk_reads * read_bytes);
+    if (!dump->buf[0] || !dump->buf[1])
+        goto err_buf;
+
+    pthread_mutex_init(&dump->lock, NULL);
+    pthread_cond_init(&dump->cond, NULL);
+    if (pthread_create(&dump->thread, NULL, dump_main, dump))
+    {
+        pthread_cond_destroy(&dump->cond);
+        pthread_mutex_destroy(&dump->lock);
+        goto err_buf;
+    }
+
+    return 0;
+
+err_buf:
+    free(dump->buf[1]);
+    free(dump->buf[0]);
+err_fd:
+    close(dump->fd);
+    return -1;
+}
+
+unsigned int xlock_dump_next(struct xlock_dump *dump, unsigned char **reads)
+{
+    unsigned int n;
+
+    pthread_mutex_lock(&dump->lock);
+    if (dump->held)
+    {
+        dump->ready[dump->cur] = 0;
+        dump->cur ^= 1;
+        dump->held = 0;
+        pthread_cond_broadcast(&dump->cond);
+    }
+
+    /* the chunk marking the end of the file is never released */
+    while (!dump->ready[dump->cur])
+        pthread_cond_wait(&dump->cond, &dump->lock);
+    n = dump->filled[dump->cur];
+    dump->held = n != 0;
+    pthread_mutex_unlock(&dump->lock);
+
+    *reads = dump->buf[dump->cur];
+    return n;
+}
+
+void xlock_dump_close(struct xlock_dump *dump)
+{
+    pthread_mutex_lock(&dump->lock);
+    dump->stop = 1;
+    pthread_cond_broadcast(&dump->cond);
+    pthread_mutex_unlock(&dump->lock);
+    pthread_join(dump->thread, NULL);
+
+    pthread_cond_destroy(&dump->cond);
+    pthread_mutex_destroy(&dump->lock);
+    free(dump->buf[1]);
+    free(dump->buf[0]);
+    close(dump->fd);
+}
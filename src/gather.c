@@ -0,0 +1,317 @@
+/**
+ * @file gather.c
+ * @brief Source-bit gather kernels
+ *
+ * This file implements the kernels that gather and XOR the source bits
+ * of a run of locks, and their runtime selection.
+ *
+ * SIMD kernels read the source 4 bytes at a time, through the 32-bit
+ * word ending at the byte holding each bit, so that no byte past the
+ * source is ever touched.
+ */
+
+#include <stdint.h>
+
+#include "../include/gather.h"
+#include "../include/xlock.h"
+
+#ifdef GATHER_X86
+#include <immintrin.h>
+#endif
+
+uint64_t gather_scalar(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    uint64_t mask = 0;
+    unsigned char b;
+    unsigned int j, k;
+    for (j = 0; j < n; j++)
+    {
+        b = 0;
+        for (k = 0; k < n_xoration; k++)
+        {
+            b ^= get_bit(source, *source_indexes++);
+        }
+        mask |= (uint64_t)b << j;
+    }
+    return mask;
+}
+
+uint64_t gather16_scalar(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    uint64_t mask = 0;
+    unsigned char b;
+    unsigned int j, k;
+    for (j = 0; j < n; j++)
+    {
+        b = 0;
+        for (k = 0; k < n_xoration; k++)
+        {
+            b ^= get_bit(source, *source_indexes++);
+        }
+        mask |= (uint64_t)b << j;
+    }
+    return mask;
+}
+
+#ifdef GATHER_X86
+
+/**
+ * @brief gathers 8 source bits
+ *
+ * @param source array of bits
+ * @param idx bit indexes
+ * @return the bits in the least significant bit of each lane
+ */
+__attribute__((target("avx2")))
+static inline __m256i gather_bits_avx2(unsigned char *source, __m256i idx)
+{
+    __m256i off, words;
+
+    /* 32-bit word ending at the byte holding each bit */
+    off = _mm256_max_epi32(_mm256_sub_epi32(_mm256_srli_epi32(idx, 3), _mm256_set1_epi32(3)), _mm256_setzero_si256());
+    words = _mm256_i32gather_epi32((int *)source, off, 1);
+    return _mm256_srlv_epi32(words, _mm256_sub_epi32(idx, _mm256_slli_epi32(off, 3)));
+}
+
+/**
+ * @brief gathers 16 source bits
+ *
+ * @param source array of bits
+ * @param idx bit indexes
+ * @return the bits in the least significant bit of each lane
+ */
+__attribute__((target("avx512f")))
+static inline __m512i gather_bits_avx512(unsigned char *source, __m512i idx)
+{
+    __m512i off, words;
+
+    /* 32-bit word ending at the byte holding each bit */
+    off = _mm512_max_epi32(_mm512_sub_epi32(_mm512_srli_epi32(idx, 3), _mm512_set1_epi32(3)), _mm512_setzero_si512());
+    words = _mm512_i32gather_epi32(off, (void *)source, 1);
+    return _mm512_srlv_epi32(words, _mm512_sub_epi32(idx, _mm512_slli_epi32(off, 3)));
+}
+
+__attribute__((target("avx2")))
+uint64_t gather_avx2(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    uint64_t mask = 0;
+    unsigned int j, k;
+    __m256i idx, acc;
+    const __m256i stride = _mm256_mullo_epi32(
+        _mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+        _mm256_set1_epi32(n_xoration));
+
+    for (j = 0; j + 8 <= n; j += 8)
+    {
+        acc = _mm256_setzero_si256();
+        for (k = 0; k < n_xoration; k++)
+        {
+            /* indexes of the kth bit of locks j..j+7 */
+            if (n_xoration == 1)
+                idx = _mm256_loadu_si256((__m256i *)(source_indexes + j));
+            else
+                idx = _mm256_i32gather_epi32((int *)(source_indexes + j * n_xoration + k), stride, 4);
+            acc = _mm256_xor_si256(acc, gather_bits_avx2(source, idx));
+        }
+        mask |= (uint64_t)(unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(acc, 31))) << j;
+    }
+    if (j < n)
+    {
+        mask |= gather_scalar(source, source_indexes + j * n_xoration, n - j, n_xoration) << j;
+    }
+    return mask;
+}
+
+__attribute__((target("avx2")))
+uint64_t gather16_avx2(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    uint64_t mask = 0;
+    unsigned int j, k;
+    uint16_t *p;
+    __m256i idx, acc, pairs = _mm256_setzero_si256();
+    const __m256i low = _mm256_set1_epi32(0xffff);
+
+    for (j = 0; j + 8 <= n; j += 8)
+    {
+        acc = _mm256_setzero_si256();
+        p = source_indexes + j * n_xoration;
+        if (n_xoration == 2)
+            pairs = _mm256_loadu_si256((__m256i *)p);
+        for (k = 0; k < n_xoration; k++)
+        {
+            /* indexes of the kth bit of locks j..j+7, widened to 32 bits */
+            if (n_xoration == 1)
+                idx = _mm256_cvtepu16_epi32(_mm_loadu_si128((__m128i *)p));
+            else if (n_xoration == 2)
+                idx = k ? _mm256_srli_epi32(pairs, 16) : _mm256_and_si256(pairs, low);
+            else
+                idx = _mm256_setr_epi32(
+                    p[k], p[n_xoration + k], p[2 * n_xoration + k], p[3 * n_xoration + k],
+                    p[4 * n_xoration + k], p[5 * n_xoration + k], p[6 * n_xoration + k], p[7 * n_xoration + k]);
+            acc = _mm256_xor_si256(acc, gather_bits_avx2(source, idx));
+        }
+        mask |= (uint64_t)(unsigned int)_mm256_movemask_ps(_mm256_castsi256_ps(_mm256_slli_epi32(acc, 31))) << j;
+    }
+    if (j < n)
+    {
+        mask |= gather16_scalar(source, source_indexes + j * n_xoration, n - j, n_xoration) << j;
+    }
+    return mask;
+}
+
+__attribute__((target("avx512f")))
+uint64_t gather_avx512(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    uint64_t mask = 0;
+    unsigned int j, k;
+    __m512i idx, acc;
+    const __m512i stride = _mm512_mullo_epi32(
+        _mm512_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+        _mm512_set1_epi32(n_xoration));
+
+    for (j = 0; j + 16 <= n; j += 16)
+    {
+        acc = _mm512_setzero_si512();
+        for (k = 0; k < n_xoration; k++)
+        {
+            /* indexes of the kth bit of locks j..j+15 */
+            if (n_xoration == 1)
+                idx = _mm512_loadu_si512((void *)(source_indexes + j));
+            else
+                idx = _mm512_i32gather_epi32(stride, (void *)(source_indexes + j * n_xoration + k), 4);
+            acc = _mm512_xor_si512(acc, gather_bits_avx512(source, idx));
+        }
+        mask |= (uint64_t)_mm512_test_epi32_mask(acc, _mm512_set1_epi32(1)) << j;
+    }
+    if (j < n)
+    {
+        mask |= gather_avx2(source, source_indexes + j * n_xoration, n - j, n_xoration) << j;
+    }
+    return mask;
+}
+
+__attribute__((target("avx512f")))
+uint64_t gather16_avx512(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    uint64_t mask = 0;
+    unsigned int j, k, l;
+    uint16_t *p;
+    unsigned int lanes[16];
+    __m512i idx, acc, pairs = _mm512_setzero_si512();
+    const __m512i low = _mm512_set1_epi32(0xffff);
+
+    for (j = 0; j + 16 <= n; j += 16)
+    {
+        acc = _mm512_setzero_si512();
+        p = source_indexes + j * n_xoration;
+        if (n_xoration == 2)
+            pairs = _mm512_loadu_si512((void *)p);
+        for (k = 0; k < n_xoration; k++)
+        {
+            /* indexes of the kth bit of locks j..j+15, widened to 32 bits */
+            if (n_xoration == 1)
+                idx = _mm512_cvtepu16_epi32(_mm256_loadu_si256((__m256i *)p));
+            else if (n_xoration == 2)
+                idx = k ? _mm512_srli_epi32(pairs, 16) : _mm512_and_si512(pairs, low);
+            else
+            {
+                for (l = 0; l < 16; l++)
+                    lanes[l] = p[l * n_xoration + k];
+                idx = _mm512_loadu_si512((void *)lanes);
+            }
+            acc = _mm512_xor_si512(acc, gather_bits_avx512(source, idx));
+        }
+        mask |= (uint64_t)_mm512_test_epi32_mask(acc, _mm512_set1_epi32(1)) << j;
+    }
+    if (j < n)
+    {
+        mask |= gather16_avx2(source, source_indexes + j * n_xoration, n - j, n_xoration) << j;
+    }
+    return mask;
+}
+
+#else
+
+uint64_t gather_avx2(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    return gather_scalar(source, source_indexes, n, n_xoration);
+}
+
+uint64_t gather16_avx2(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    return gather16_scalar(source, source_indexes, n, n_xoration);
+}
+
+uint64_t gather_avx512(
+    unsigned char *source,
+    unsigned int *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    return gather_scalar(source, source_indexes, n, n_xoration);
+}
+
+uint64_t gather16_avx512(
+    unsigned char *source,
+    uint16_t *source_indexes,
+    unsigned int n,
+    unsigned int n_xoration)
+{
+    return gather16_scalar(source, source_indexes, n, n_xoration);
+}
+
+#endif
+
+gather_fn gather_select(void)
+{
+#ifdef GATHER_X86
+    if (__builtin_cpu_supports("avx512f"))
+        return gather_avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return gather_avx2;
+#endif
+    return gather_scalar;
+}
+
+gather16_fn gather16_select(void)
+{
+#ifdef GATHER_X86
+    if (__builtin_cpu_supports("avx512f"))
+        return gather16_avx512;
+    if (__builtin_cpu_supports("avx2"))
+        return gather16_avx2;
+#endif
+    return gather16_scalar;
+}
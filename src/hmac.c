@@ -0,0 +1,333 @@
+/**
+ * @file hmac.c
+ * @brief HMAC-SHA256 and random bytes for X-Lock
+ *
+ * This file implements the OpenSSL and the built-in backends of the
+ * X-Lock primitives.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/hmac.h"
+
+#ifdef _NO_OPENSSL_
+
+#include <errno.h>
+#include <sys/random.h>
+
+/**
+ * @brief SHA-256 block length in bytes
+ */
+#define SHA256_BLOCK 64
+
+/**
+ * @brief Rotates the 32-bit word x right by n bits.
+ */
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * @brief SHA-256 round constants
+ */
+static uint32_t sha256_k[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+/**
+ * @brief SHA-256 state
+ */
+struct sha256
+{
+    uint32_t h[8];                   /**< chaining value */
+    unsigned char b[SHA256_BLOCK];   /**< pending block */
+    size_t n;                        /**< bytes in the pending block */
+    uint64_t len;                    /**< message length in bytes */
+};
+
+/**
+ * @brief compresses one block into the state
+ *
+ * @param s SHA-256 state
+ * @param b block of SHA256_BLOCK bytes
+ * @return void
+ */
+void sha256_block(struct sha256 *s, unsigned char *b)
+{
+    uint32_t w[64], t1, t2;
+    uint32_t a = s->h[0], c = s->h[2], e = s->h[4], g = s->h[6];
+    uint32_t bb = s->h[1], d = s->h[3], f = s->h[5], h = s->h[7];
+    int i;
+
+    for (i = 0; i < 16; i++)
+        w[i] = (uint32_t)b[4 * i] << 24 | (uint32_t)b[4 * i + 1] << 16 | (uint32_t)b[4 * i + 2] << 8 | b[4 * i + 3];
+    for (; i < 64; i++)
+        w[i] = w[i - 16] + (ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3)) +
+               w[i - 7] + (ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10));
+
+    for (i = 0; i < 64; i++)
+    {
+        t1 = h + (ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25)) + ((e & f) ^ (~e & g)) + sha256_k[i] + w[i];
+        t2 = (ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22)) + ((a & bb) ^ (a & c) ^ (bb & c));
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = bb;
+        bb = a;
+        a = t1 + t2;
+    }
+
+    s->h[0] += a;
+    s->h[1] += bb;
+    s->h[2] += c;
+    s->h[3] += d;
+    s->h[4] += e;
+    s->h[5] += f;
+    s->h[6] += g;
+    s->h[7] += h;
+}
+
+/**
+ * @brief initializes a SHA-256 state
+ *
+ * @param s SHA-256 state
+ * @return void
+ */
+void sha256_init(struct sha256 *s)
+{
+    s->h[0] = 0x6a09e667;
+    s->h[1] = 0xbb67ae85;
+    s->h[2] = 0x3c6ef372;
+    s->h[3] = 0xa54ff53a;
+    s->h[4] = 0x510e527f;
+    s->h[5] = 0x9b05688c;
+    s->h[6] = 0x1f83d9ab;
+    s->h[7] = 0x5be0cd19;
+    s->n = 0;
+    s->len = 0;
+}
+
+/**
+ * @brief absorbs a message chunk
+ *
+ * @param s SHA-256 state
+ * @param data message chunk
+ * @param size chunk length in bytes
+ * @return void
+ */
+void sha256_update(struct sha256 *s, unsigned char *data, size_t size)
+{
+    size_t n;
+
+    s->len += size;
+    while (size)
+    {
+        n = SHA256_BLOCK - s->n < size ? SHA256_BLOCK - s->n : size;
+        memcpy(s->b + s->n, data, n);
+        s->n += n;
+        data += n;
+        size -= n;
+        if (s->n == SHA256_BLOCK)
+        {
+            sha256_block(s, s->b);
+            s->n = 0;
+        }
+    }
+}
+
+/**
+ * @brief pads the message and outputs the digest
+ *
+ * @param s SHA-256 state
+ * @param md storage for HMAC_BYTES bytes
+ * @return void
+ */
+void sha256_final(struct sha256 *s, unsigned char *md)
+{
+    uint64_t bits = s->len * 8;
+    int i;
+
+    s->b[s->n++] = 0x80;
+    if (s->n > SHA256_BLOCK - 8)
+    {
+        memset(s->b + s->n, 0, SHA256_BLOCK - s->n);
+        sha256_block(s, s->b);
+        s->n = 0;
+    }
+    memset(s->b + s->n, 0, SHA256_BLOCK - 8 - s->n);
+    for (i = 0; i < 8; i++)
+        s->b[SHA256_BLOCK - 1 - i] = (unsigned char)(bits >> (8 * i));
+    sha256_block(s, s->b);
+
+    for (i = 0; i < 8; i++)
+    {
+        md[4 * i] = (unsigned char)(s->h[i] >> 24);
+        md[4 * i + 1] = (unsigned char)(s->h[i] >> 16);
+        md[4 * i + 2] = (unsigned char)(s->h[i] >> 8);
+        md[4 * i + 3] = (unsigned char)s->h[i];
+    }
+}
+
+int hmac_sha256(unsigned char *key, size_t key_len, unsigned char *data, size_t data_len, unsigned char *md)
+{
+    struct sha256 s;
+    unsigned char pad[SHA256_BLOCK];
+    unsigned char inner[HMAC_BYTES];
+    int i;
+
+    /* keys longer than a block are hashed first */
+    memset(pad, 0, SHA256_BLOCK);
+    if (key_len > SHA256_BLOCK)
+    {
+        sha256_init(&s);
+        sha256_update(&s, key, key_len);
+        sha256_final(&s, pad);
+    }
+    else
+    {
+        memcpy(pad, key, key_len);
+    }
+
+    /* inner = hash(key ^ ipad, data) */
+    for (i = 0; i < SHA256_BLOCK; i++)
+        pad[i] ^= 0x36;
+    sha256_init(&s);
+    sha256_update(&s, pad, SHA256_BLOCK);
+    sha256_update(&s, data, data_len);
+    sha256_final(&s, inner);
+
+    /* md = hash(key ^ opad, inner) */
+    for (i = 0; i < SHA256_BLOCK; i++)
+        pad[i] ^= 0x36 ^ 0x5c;
+    sha256_init(&s);
+    sha256_update(&s, pad, SHA256_BLOCK);
+    sha256_update(&s, inner, HMAC_BYTES);
+    sha256_final(&s, md);
+
+    return 0;
+}
+
+int random_bytes(unsigned char *b, size_t size)
+{
+    ssize_t n;
+
+    while (size)
+    {
+        n = getrandom(b, size, 0);
+        if (n < 0)
+        {
+            if (errno == EINTR)
+                continue;
+            return -1;
+        }
+        b += n;
+        size -= n;
+    }
+
+    return 0;
+}
+
+#else
+
+#include <pthread.h>
+#include <openssl/core_names.h>
+#include <openssl/evp.h>
+#include <openssl/params.h>
+#include <openssl/rand.h>
+
+/**
+ * @brief HMAC implementation, fetched once per process
+ */
+static EVP_MAC *hmac_mac;
+
+/**
+ * @brief guards the fetch of hmac_mac and the creation of hmac_key
+ */
+static pthread_once_t hmac_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief frees the MAC context of an exiting thread
+ */
+static pthread_key_t hmac_key;
+
+/**
+ * @brief MAC context of the calling thread, set up for SHA-256
+ */
+static __thread EVP_MAC_CTX *hmac_ctx;
+
+/**
+ * @brief fetches the HMAC implementation
+ *
+ * @return void
+ */
+void hmac_setup(void)
+{
+    hmac_mac = EVP_MAC_fetch(NULL, "HMAC", NULL);
+    pthread_key_create(&hmac_key, (void (*)(void *))EVP_MAC_CTX_free);
+}
+
+/**
+ * @brief returns the MAC context of the calling thread
+ *
+ * The context is created and bound to SHA-256 on first use, then only
+ * rekeyed by hmac_sha256().
+ *
+ * @return the MAC context, NULL on failure
+ */
+EVP_MAC_CTX *hmac_thread_ctx(void)
+{
+    OSSL_PARAM params[2];
+
+    if (hmac_ctx)
+        return hmac_ctx;
+
+    pthread_once(&hmac_once, hmac_setup);
+    if (!hmac_mac || !(hmac_ctx = EVP_MAC_CTX_new(hmac_mac)))
+        return NULL;
+
+    params[0] = OSSL_PARAM_construct_utf8_string(OSSL_MAC_PARAM_DIGEST, "SHA256", 0);
+    params[1] = OSSL_PARAM_construct_end();
+    if (!EVP_MAC_CTX_set_params(hmac_ctx, params))
+    {
+        EVP_MAC_CTX_free(hmac_ctx);
+        hmac_ctx = NULL;
+        return NULL;
+    }
+    pthread_setspecific(hmac_key, hmac_ctx);
+
+    return hmac_ctx;
+}
+
+int hmac_sha256(unsigned char *key, size_t key_len, unsigned char *data, size_t data_len, unsigned char *md)
+{
+    EVP_MAC_CTX *ctx = hmac_thread_ctx();
+    size_t md_len;
+
+    if (!ctx ||
+        !EVP_MAC_init(ctx, key, key_len, NULL) ||
+        !EVP_MAC_update(ctx, data, data_len) ||
+        !EVP_MAC_final(ctx, md, &md_len, HMAC_BYTES))
+    {
+#ifdef _DEBUG_
+        printf("error: HMAC-SHA256 failed\n");
+#endif
+        return -1;
+    }
+
+    return 0;
+}
+
+int random_bytes(unsigned char *b, size_t size)
+{
+    return RAND_bytes(b, size) == 1 ? 0 : -1;
+}
+
+#endif
@@ -10,7 +10,7 @@
 #endif
 
 #include <stdlib.h>
-#include <string.h>
+#include <stdint.h>
 
 #ifdef _SPEED_
 #include "../include/tictoc.h"
@@ -21,9 +21,170 @@
 #include "../include/bits.h"
 #include "../include/indexes.h"
 
+/**
+ * @brief number of Feistel rounds of the permutation
+ */
+#define PERM_ROUNDS 4
+
+/**
+ * @brief mixes the bits of a 64-bit word
+ *
+ * @param x input word
+ * @return mixed word
+ * @see SplitMix64 finalizer
+ */
+uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xbf58476d1ce4e5b9ULL;
+    x ^= x >> 27;
+    x *= 0x94d049bb133111ebULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t prng_counter(uint64_t seed, uint64_t n)
+{
+    return mix64(seed + (n + 1) * 0x9e3779b97f4a7c15ULL);
+}
+
+/**
+ * @brief maps a PRNG output into [0, range)
+ *
+ * @param r PRNG output
+ * @param range size of the range
+ * @return a number in [0, range)
+ */
+unsigned int prng_bounded(uint64_t r, unsigned int range)
+{
+    return (unsigned int)(((r >> 32) * range) >> 32);
+}
+
+/**
+ * @brief returns the Feistel half size for a permutation of [0, domain)
+ *
+ * @param domain size of the permuted range
+ * @return the bits of each half of the smallest even-sized Feistel
+ * domain covering the range
+ */
+unsigned int perm_half(unsigned int domain)
+{
+    unsigned int half = 1;
+    while (half < 16 && (1ULL << (2 * half)) < domain)
+    {
+        half++;
+    }
+    return half;
+}
+
+/**
+ * @brief retrieves the element of a keyed permutation of [0, domain)
+ *
+ * This function applies a balanced Feistel network over 2 * half bits
+ * to x and cycle-walks until the result falls back into [0, domain).
+ *
+ * @param key permutation key
+ * @param half bits of each Feistel half
+ * @param domain size of the permuted range
+ * @param x position in the permutation
+ * @return the element in position x
+ */
+unsigned int perm_index(uint64_t key, unsigned int half, unsigned int domain, unsigned int x)
+{
+    unsigned int l, r, t, round;
+    unsigned int mask = (1U << half) - 1;
+
+    do
+    {
+        l = x >> half;
+        r = x & mask;
+        for (round = 0; round < PERM_ROUNDS; round++)
+        {
+            t = l ^ ((unsigned int)prng_counter(key, (uint64_t)round << 32 | r) & mask);
+            l = r;
+            r = t;
+        }
+        x = l << half | r;
+    } while (x >= domain);
+
+    return x;
+}
+
+#ifdef _DEBUG_
+/**
+ * @brief checks the arguments of a permutation slice
+ *
+ * @param offset position of the first number in the permutation
+ * @param size number of indexes
+ * @param indexes pointer to the array of indexes
+ * @param lowerbound lowest index value, included
+ * @param upperbound highest index value, excluded
+ * @return 0 if the arguments are valid, -1 otherwise
+ */
+int perm_check(size_t offset, size_t size, void *indexes, unsigned lowerbound, unsigned upperbound)
+{
+    if (size < 1)
+    {
+        printf("error: size < 1\n");
+
+        return -1;
+    }
+
+    if (upperbound <= lowerbound)
+    {
+        printf("error: upperbound <= lowerbound\n");
+
+        return -1;
+    }
+
+    if (upperbound - lowerbound < offset + size)
+    {
+        printf("error: upperbound - lowerbound < offset + size (%u - %u < %zu)\n", upperbound, lowerbound, offset + size);
+
+        return -1;
+    }
+
+    if (!indexes)
+    {
+        printf("error: indexes is NULL\n");
+
+        return -1;
+    }
+
+    return 0;
+}
+#endif
+
+/**
+ * @brief retrieves, generates or assigns a PRNG seed
+ *
+ * @param seed seed for the PRNG
+ * @return *seed if it is set, otherwise a time-based seed that is
+ * also stored in *seed
+ */
+unsigned long prng_seed(unsigned long *seed)
+{
+    unsigned long _seed;
+
+    if (seed && *seed)
+    {
+        _seed = *seed;
+    }
+    else
+    {
+        _seed = (unsigned long)time(NULL);
+        if (seed)
+        {
+            *seed = _seed;
+        }
+    }
+    return _seed;
+}
+
 double prng_rand(unsigned long *seed, size_t size, unsigned *indexes, unsigned lowerbound, unsigned upperbound, char replacement)
 {
-    unsigned int index, i;
+    unsigned int i, range, half;
+    uint64_t key;
     unsigned long _seed;
 
 #ifdef _SPEED_
@@ -62,45 +223,29 @@ double prng_rand(unsigned long *seed, size_t size, unsigned *indexes, unsigned l
     }
 #endif
 
-    unsigned char arr[upperbound - lowerbound + 1];
-    if (!replacement)
-    {
-        memset(arr, 0, upperbound - lowerbound + 1);
-    }
-
 #ifdef _SPEED_
     TIC(start);
 #endif
 
-    /* retrieve or generate or assign PRNG seed */
-    if (seed && *seed)
-    {
-        _seed = *seed;
-    }
-    else
+    _seed = prng_seed(seed);
+
+    /* generate indexes, without replacement as the head of a permutation */
+    range = upperbound - lowerbound;
+    if (replacement)
     {
-        _seed = (unsigned long)time(NULL);
-        if (seed)
+        for (i = 0; i < size; i++)
         {
-            *seed = _seed;
+            indexes[i] = lowerbound + prng_bounded(prng_counter(_seed, i), range);
         }
     }
-    srand(_seed);
-
-    /* generate indexes */
-    i = 0;
-    while (i < size)
+    else
     {
-        index = (rand() + lowerbound) % upperbound;
-        if (!replacement)
+        key = mix64(_seed);
+        half = perm_half(range);
+        for (i = 0; i < size; i++)
         {
-            while (char_check_bit(arr, index))
-            {
-                index = (index + 1) % upperbound;
-            }
-            char_set_bit(arr, index);
+            indexes[i] = lowerbound + perm_index(key, half, range, i);
         }
-        indexes[i++] = index;
     }
 
 #ifdef _SPEED_
@@ -119,4 +264,78 @@ double prng_rand_with_replacement(unsigned long *seed, size_t size, unsigned *in
 double prng_rand_without_replacement(unsigned long *seed, size_t size, unsigned *indexes, unsigned lowerbound, unsigned upperbound)
 {
     return prng_rand(seed, size, indexes, lowerbound, upperbound, 0);
+}
+
+double prng_rand_permutation(unsigned long *seed, size_t offset, size_t size, unsigned *indexes, unsigned lowerbound, unsigned upperbound)
+{
+    unsigned int domain, half;
+    size_t i;
+    uint64_t key;
+
+#ifdef _SPEED_
+    struct timespec start, end;
+#endif
+
+#ifdef _DEBUG_
+    if (perm_check(offset, size, indexes, lowerbound, upperbound))
+        return -1;
+#endif
+
+#ifdef _SPEED_
+    TIC(start);
+#endif
+
+    key = mix64(prng_seed(seed));
+    domain = upperbound - lowerbound;
+    half = perm_half(domain);
+
+    /* generate indexes */
+    for (i = 0; i < size; i++)
+    {
+        indexes[i] = lowerbound + perm_index(key, half, domain, offset + i);
+    }
+
+#ifdef _SPEED_
+    TOC(end);
+    return TIC_TOC(start, end);
+#else
+    return 0;
+#endif
+}
+
+double prng_rand_permutation16(unsigned long *seed, size_t offset, size_t size, uint16_t *indexes, unsigned lowerbound, unsigned upperbound)
+{
+    unsigned int domain, half;
+    size_t i;
+    uint64_t key;
+
+#ifdef _SPEED_
+    struct timespec start, end;
+#endif
+
+#ifdef _DEBUG_
+    if (perm_check(offset, size, indexes, lowerbound, upperbound))
+        return -1;
+#endif
+
+#ifdef _SPEED_
+    TIC(start);
+#endif
+
+    key = mix64(prng_seed(seed));
+    domain = upperbound - lowerbound;
+    half = perm_half(domain);
+
+    /* generate indexes */
+    for (i = 0; i < size; i++)
+    {
+        indexes[i] = (uint16_t)(lowerbound + perm_index(key, half, domain, offset + i));
+    }
+
+#ifdef _SPEED_
+    TOC(end);
+    return TIC_TOC(start, end);
+#else
+    return 0;
+#endif
 }
\ No newline at end of file
@@ -0,0 +1,241 @@
+/**
+ * @file plan.c
+ * @brief Unlock plan cache
+ *
+ * This file implements a bounded LRU cache of unlock plans. Entries are
+ * linked in recency order and indexed by a linear-probing hash table
+ * with backward-shift deletion, so lookups, insertions and evictions
+ * take constant expected time.
+ */
+
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/indexes.h"
+#include "../include/context.h"
+#include "../include/plan.h"
+
+/**
+ * @brief marks the end of the recency list
+ */
+#define PLAN_NONE 0xffffffffU
+
+/**
+ * @brief alignment of the cache arrays
+ */
+#define PLAN_ALIGN 16
+
+/**
+ * @brief Returns n rounded up to a multiple of PLAN_ALIGN.
+ */
+#define PLAN_ROUND(n) (((n) + PLAN_ALIGN - 1) / PLAN_ALIGN * PLAN_ALIGN)
+
+/**
+ * @brief returns the hash table size of a cache
+ *
+ * @param capacity maximum number of plans
+ * @return the smallest power of two at least twice capacity
+ */
+size_t plan_slots(unsigned int capacity)
+{
+    size_t n = 1;
+    while (n < 2 * (size_t)capacity)
+    {
+        n <<= 1;
+    }
+    return n;
+}
+
+/**
+ * @brief returns the number of indexes in a plan
+ *
+ * @param params X-Lock parameters
+ * @return key_pre_bits * (1 + n_locks * n_xoration)
+ */
+size_t plan_indexes(struct xlock_params *params)
+{
+    return (size_t)params->key_pre_bits * (1 + (size_t)params->n_locks * params->n_xoration);
+}
+
+size_t plan_cache_size(struct xlock_params *params, unsigned int capacity)
+{
+    return PLAN_ALIGN - 1 +
+           PLAN_ROUND(capacity * sizeof(struct plan_entry)) +
+           PLAN_ROUND(plan_slots(capacity) * sizeof(unsigned int)) +
+           PLAN_ROUND(capacity * plan_indexes(params) * xlock_index_bytes(params));
+}
+
+int plan_cache_init(
+    struct plan_cache *cache,
+    struct xlock_params *params,
+    unsigned int capacity,
+    void *buf,
+    size_t size)
+{
+    unsigned char *p;
+
+    if (!capacity || capacity == PLAN_NONE || !buf || size < plan_cache_size(params, capacity))
+        return -1;
+
+    cache->params = *params;
+    cache->capacity = capacity;
+    cache->mask = plan_slots(capacity) - 1;
+    cache->plan_size = plan_indexes(params) * xlock_index_bytes(params);
+
+    p = (unsigned char *)PLAN_ROUND((uintptr_t)buf);
+    cache->entries = (struct plan_entry *)p;
+    p += PLAN_ROUND(capacity * sizeof(struct plan_entry));
+    cache->slots = (unsigned int *)p;
+    p += PLAN_ROUND(plan_slots(capacity) * sizeof(unsigned int));
+    cache->plans = p;
+
+    plan_cache_clear(cache);
+
+    return 0;
+}
+
+void plan_cache_clear(struct plan_cache *cache)
+{
+    memset(cache->slots, 0, (cache->mask + 1) * sizeof(unsigned int));
+    cache->used = 0;
+    cache->head = PLAN_NONE;
+    cache->tail = PLAN_NONE;
+    cache->hits = 0;
+    cache->misses = 0;
+    cache->evictions = 0;
+}
+
+/**
+ * @brief unlinks an entry from the recency list
+ *
+ * @param cache plan cache
+ * @param e entry
+ * @return void
+ */
+void plan_unlink(struct plan_cache *cache, unsigned int e)
+{
+    struct plan_entry *entry = &cache->entries[e];
+
+    if (entry->prev != PLAN_NONE)
+        cache->entries[entry->prev].next = entry->next;
+    else
+        cache->head = entry->next;
+    if (entry->next != PLAN_NONE)
+        cache->entries[entry->next].prev = entry->prev;
+    else
+        cache->tail = entry->prev;
+}
+
+/**
+ * @brief links an entry as the most recently used
+ *
+ * @param cache plan cache
+ * @param e entry
+ * @return void
+ */
+void plan_push(struct plan_cache *cache, unsigned int e)
+{
+    struct plan_entry *entry = &cache->entries[e];
+
+    entry->prev = PLAN_NONE;
+    entry->next = cache->head;
+    if (cache->head != PLAN_NONE)
+        cache->entries[cache->head].prev = e;
+    else
+        cache->tail = e;
+    cache->head = e;
+}
+
+/**
+ * @brief removes an entry from the hash table
+ *
+ * This function empties the slot of the entry and shifts back the
+ * following entries of its probe sequence, so that no tombstones are
+ * needed.
+ *
+ * @param cache plan cache
+ * @param e entry
+ * @return void
+ */
+void plan_unhash(struct plan_cache *cache, unsigned int e)
+{
+    unsigned int i = cache->entries[e].slot, j = i, home;
+
+    cache->slots[i] = 0;
+    for (;;)
+    {
+        j = (j + 1) & cache->mask;
+        if (!cache->slots[j])
+            break;
+        home = cache->entries[cache->slots[j] - 1].hash & cache->mask;
+        /* move j into the hole unless its home lies in (i, j] */
+        if ((i <= j) ? (home <= i || home > j) : (home <= i && home > j))
+        {
+            cache->slots[i] = cache->slots[j];
+            cache->entries[cache->slots[i] - 1].slot = i;
+            cache->slots[j] = 0;
+            i = j;
+        }
+    }
+}
+
+void *plan_cache_get(struct plan_cache *cache, unsigned long source_seed, unsigned long key_seed)
+{
+    struct xlock_params *params = &cache->params;
+    struct plan_entry *entry;
+    unsigned char *plan;
+    unsigned long hash = prng_counter(source_seed, key_seed);
+    unsigned int e, i = hash & cache->mask;
+
+    /* lookup */
+    while (cache->slots[i])
+    {
+        e = cache->slots[i] - 1;
+        entry = &cache->entries[e];
+        if (entry->source_seed == source_seed && entry->key_seed == key_seed)
+        {
+            cache->hits++;
+            plan_unlink(cache, e);
+            plan_push(cache, e);
+            return cache->plans + e * cache->plan_size;
+        }
+        i = (i + 1) & cache->mask;
+    }
+    cache->misses++;
+
+    /* take a free entry or evict the least recently used one */
+    if (cache->used < cache->capacity)
+    {
+        e = cache->used++;
+    }
+    else
+    {
+        e = cache->tail;
+        plan_unlink(cache, e);
+        plan_unhash(cache, e);
+        cache->evictions++;
+
+        /* the hole may have moved the probe end */
+        i = hash & cache->mask;
+        while (cache->slots[i])
+        {
+            i = (i + 1) & cache->mask;
+        }
+    }
+
+    entry = &cache->entries[e];
+    entry->source_seed = source_seed;
+    entry->key_seed = key_seed;
+    entry->hash = hash;
+    entry->slot = i;
+    cache->slots[i] = e + 1;
+    plan_push(cache, e);
+
+    /* derive the plan */
+    plan = cache->plans + e * cache->plan_size;
+    xlock_indexes(
+        params, &source_seed, &key_seed,
+        plan, plan + params->key_pre_bits * xlock_index_bytes(params));
+
+    return plan;
+}
@@ -0,0 +1,148 @@
+/**
+ * @file profile.c
+ * @brief Specialized lock/unlock profiles
+ *
+ * This file instantiates lock_range() and unlock() for the (n_locks, n_xoration)
+ * profiles used in production. With both parameters known at compile
+ * time, the XOR-ation loops are fully unrolled and the vote threshold
+ * is a constant.
+ *
+ * The profiles beat the portable gather by 2-3x, but lose to the SIMD
+ * gather kernels by 1.3-1.8x, fixing n_locks and n_xoration over the
+ * SIMD kernels gaining nothing. They are thus only built where the SIMD
+ * kernels are not, and profile_select() finds none otherwise.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "../include/bits.h"
+#include "../include/gather.h"
+#include "../include/profile.h"
+#include "../include/xlock.h"
+
+#ifndef GATHER_X86
+
+#ifdef __GNUC__
+#define UNROLL _Pragma("GCC unroll 64")
+#else
+#define UNROLL
+#endif
+
+/**
+ * @brief Returns the locks of the word starting at lock w.
+ */
+#define WORD_LOCKS(L, w) ((L) - (w) < 64 ? (L) - (w) : 64)
+
+/**
+ * @brief Defines the kernels of the profile (L, C) for index type T.
+ */
+#define PROFILE_KERNELS(L, C, W, T)                                                 \
+    static uint64_t gather##W##_##L##_##C(                                          \
+        unsigned char *source,                                                      \
+        T *source_indexes,                                                          \
+        unsigned int w)                                                             \
+    {                                                                               \
+        uint64_t mask = 0, b;                                                       \
+        unsigned int j, k;                                                          \
+        source_indexes += w * (C);                                                  \
+        UNROLL                                                                      \
+        for (j = 0; j < WORD_LOCKS(L, w); j++)                                      \
+        {                                                                           \
+            b = 0;                                                                  \
+            UNROLL                                                                  \
+            for (k = 0; k < (C); k++)                                               \
+            {                                                                       \
+                b ^= char_check_bit(source, source_indexes[j * (C) + k]);           \
+            }                                                                       \
+            mask |= b << j;                                                         \
+        }                                                                           \
+        return mask;                                                                \
+    }                                                                               \
+                                                                                    \
+    static void lock##W##_##L##_##C(                                                \
+        unsigned char *source,                                                      \
+        T *source_indexes,                                                          \
+        unsigned char *pool,                                                        \
+        unsigned int first,                                                         \
+        unsigned int count,                                                         \
+        unsigned char *vault)                                                       \
+    {                                                                               \
+        uint64_t b;                                                                 \
+        unsigned int i, w;                                                          \
+        for (i = first; i < first + count; i++, source_indexes += (L) * (C))        \
+        {                                                                           \
+            b = char_check_bit(pool, i) ? ~0ULL : 0;                                \
+            for (w = 0; w < (L); w += 64)                                           \
+            {                                                                       \
+                set_bits(vault, i * (L) + w, WORD_LOCKS(L, w),                      \
+                         b ^ gather##W##_##L##_##C(source, source_indexes, w));     \
+            }                                                                       \
+        }                                                                           \
+    }                                                                               \
+                                                                                    \
+    static void unlock##W##_##L##_##C(                                              \
+        unsigned char *source,                                                      \
+        T *source_indexes,                                                          \
+        unsigned char *vault,                                                       \
+        unsigned char *key,                                                         \
+        T *key_indexes,                                                             \
+        unsigned int key_bits)                                                      \
+    {                                                                               \
+        unsigned int i, w, c;                                                       \
+        for (i = 0; i < key_bits; i++, source_indexes += (L) * (C))                 \
+        {                                                                           \
+            c = 0;                                                                  \
+            for (w = 0; w < (L); w += 64)                                           \
+            {                                                                       \
+                c += popcount64(                                                    \
+                    get_bits(vault, key_indexes[i] * (L) + w, WORD_LOCKS(L, w)) ^   \
+                    gather##W##_##L##_##C(source, source_indexes, w));              \
+            }                                                                       \
+            set_bit_v(key, i, c > (L) / 2);                                         \
+        }                                                                           \
+    }
+
+/**
+ * @brief Defines the kernels of the profile (L, C).
+ */
+#define PROFILE(L, C)                     \
+    PROFILE_KERNELS(L, C, , unsigned int) \
+    PROFILE_KERNELS(L, C, 16, uint16_t)
+
+/**
+ * @brief Returns the table entry of the profile (L, C).
+ */
+#define PROFILE_ENTRY(L, C) {L, C, lock_##L##_##C, unlock_##L##_##C, lock16_##L##_##C, unlock16_##L##_##C}
+
+PROFILE(32, 2)
+PROFILE(64, 1)
+PROFILE(64, 2)
+PROFILE(64, 3)
+PROFILE(128, 2)
+
+struct profile profiles[] = {
+    PROFILE_ENTRY(32, 2),
+    PROFILE_ENTRY(64, 1),
+    PROFILE_ENTRY(64, 2),
+    PROFILE_ENTRY(64, 3),
+    PROFILE_ENTRY(128, 2),
+};
+
+#endif
+
+struct profile *profile_select(unsigned int n_locks, unsigned int n_xoration)
+{
+#ifndef GATHER_X86
+    size_t i;
+    for (i = 0; i < sizeof(profiles) / sizeof(profiles[0]); i++)
+    {
+        if (profiles[i].n_locks == n_locks && profiles[i].n_xoration == n_xoration)
+            return &profiles[i];
+    }
+#else
+    (void)n_locks;
+    (void)n_xoration;
+#endif
+    return NULL;
+}
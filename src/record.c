@@ -0,0 +1,211 @@
+/**
+ * @file record.c
+ * @brief Helper data records
+ *
+ * This file implements the helper data records of X-Lock. A record is
+ * laid out as its header, the vault, the token and the optional error
+ * map, each array starting on a multiple of XLOCK_RECORD_ALIGN.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/bits.h"
+#include "../include/context.h"
+#include "../include/record.h"
+
+/**
+ * @brief Returns n rounded up to a multiple of XLOCK_RECORD_ALIGN.
+ */
+#define RECORD_ROUND(n) (((n) + XLOCK_RECORD_ALIGN - 1) / XLOCK_RECORD_ALIGN * XLOCK_RECORD_ALIGN)
+
+/**
+ * @brief offsets of the arrays of a record
+ */
+struct record_layout
+{
+    uint64_t vault; /**< offset of the vault */
+    uint64_t token; /**< offset of the token */
+    uint64_t e_map; /**< offset of the error map, or 0 */
+    uint64_t size;  /**< record length */
+};
+
+/**
+ * @brief lays out the arrays of a record
+ *
+ * Lengths are computed in 64 bits, so that oversized parameters are
+ * caught by the caller rather than wrapped around.
+ *
+ * @param params X-Lock parameters
+ * @param e_map 0 for a record without error map, otherwise with
+ * @param layout storage for the offsets
+ * @return void
+ */
+void record_layout(struct xlock_params *params, int e_map, struct record_layout *layout)
+{
+    uint64_t vault_bytes = ((uint64_t)params->pool_bits * params->n_locks + 7) / 8;
+
+    layout->vault = RECORD_ROUND(sizeof(struct xlock_record));
+    layout->token = layout->vault + RECORD_ROUND(vault_bytes);
+    layout->size = layout->token + RECORD_ROUND((uint64_t)params->token_bytes);
+    layout->e_map = 0;
+    if (e_map)
+    {
+        layout->e_map = layout->size;
+        layout->size += RECORD_ROUND((uint64_t)params->source_bits);
+    }
+}
+
+size_t xlock_record_size(struct xlock_params *params, int e_map)
+{
+    struct record_layout layout;
+
+    record_layout(params, e_map, &layout);
+    return layout.size;
+}
+
+int xlock_record_write(
+    struct xlock_record *rec,
+    size_t size,
+    struct xlock_params *params,
+    unsigned long source_seed,
+    unsigned long key_seed,
+    unsigned long nonce,
+    unsigned char *vault,
+    unsigned char *token,
+    unsigned char *e_map)
+{
+    struct record_layout layout;
+    unsigned char *p = (unsigned char *)rec;
+
+    record_layout(params, e_map != NULL, &layout);
+    if ((uintptr_t)rec % XLOCK_RECORD_ALIGN || size < layout.size || layout.size > UINT32_MAX)
+    {
+#ifdef _DEBUG_
+        printf("error: record storage too small or misaligned\n");
+#endif
+        return -1;
+    }
+
+    /* padding is zeroed, so that equal records are equal byte for byte */
+    memset(rec, 0, layout.size);
+    rec->magic = XLOCK_RECORD_MAGIC;
+    rec->version = XLOCK_RECORD_VERSION;
+    rec->flags = e_map ? XLOCK_RECORD_E_MAP : 0;
+    rec->size = layout.size;
+    rec->source_bits = params->source_bits;
+    rec->pool_bits = params->pool_bits;
+    rec->key_bits = params->key_bits;
+    rec->key_pre_bits = params->key_pre_bits;
+    rec->token_bytes = params->token_bytes;
+    rec->n_locks = params->n_locks;
+    rec->n_xoration = params->n_xoration;
+    rec->source_seed = source_seed;
+    rec->key_seed = key_seed;
+    rec->nonce = nonce;
+    rec->vault = layout.vault;
+    rec->token = layout.token;
+    rec->e_map = layout.e_map;
+
+    memcpy(p + layout.vault, vault, bits_to_bytes((uint64_t)params->pool_bits * params->n_locks));
+    memcpy(p + layout.token, token, params->token_bytes);
+    if (e_map)
+        memcpy(p + layout.e_map, e_map, params->source_bits);
+
+    return 0;
+}
+
+int xlock_record_check(struct xlock_record *rec, size_t size)
+{
+    struct record_layout layout;
+    struct xlock_params params;
+
+    if ((uintptr_t)rec % XLOCK_RECORD_ALIGN || size < sizeof(struct xlock_record) ||
+        rec->magic != XLOCK_RECORD_MAGIC || rec->version != XLOCK_RECORD_VERSION ||
+        rec->flags & ~XLOCK_RECORD_E_MAP || rec->reserved)
+    {
+#ifdef _DEBUG_
+        printf("error: not an X-Lock record of version %u\n", XLOCK_RECORD_VERSION);
+#endif
+        return -1;
+    }
+
+    xlock_record_params(rec, &params);
+    if (!params.n_locks || !params.n_xoration || !params.pool_bits ||
+        !params.token_bytes || !params.source_bits ||
+        !rec->source_seed || !rec->key_seed)
+    {
+#ifdef _DEBUG_
+        printf("error: record parameters are invalid\n");
+#endif
+        return -1;
+    }
+
+    /* version 1 records have exactly the canonical layout */
+    record_layout(&params, rec->flags & XLOCK_RECORD_E_MAP, &layout);
+    if (rec->size != layout.size || rec->size > size || rec->vault != layout.vault ||
+        rec->token != layout.token || rec->e_map != layout.e_map)
+    {
+#ifdef _DEBUG_
+        printf("error: record layout is invalid\n");
+#endif
+        return -1;
+    }
+
+    return 0;
+}
+
+void xlock_record_params(struct xlock_record *rec, struct xlock_params *params)
+{
+    params->source_bits = rec->source_bits;
+    params->pool_bits = rec->pool_bits;
+    params->key_bits = rec->key_bits;
+    params->key_pre_bits = rec->key_pre_bits;
+    params->token_bytes = rec->token_bytes;
+    params->n_locks = rec->n_locks;
+    params->n_xoration = rec->n_xoration;
+}
+
+unsigned char *xlock_record_vault(struct xlock_record *rec)
+{
+    return (unsigned char *)rec + rec->vault;
+}
+
+unsigned char *xlock_record_token(struct xlock_record *rec)
+{
+    return (unsigned char *)rec + rec->token;
+}
+
+unsigned char *xlock_record_e_map(struct xlock_record *rec)
+{
+    return rec->e_map ? (unsigned char *)rec + rec->e_map : NULL;
+}
+
+int xlock_record_rep(struct xlock_ctx *ctx, struct xlock_record *rec, unsigned char *read, unsigned char *key)
+{
+    struct xlock_params params;
+    unsigned long source_seed = rec->source_seed;
+    unsigned long key_seed = rec->key_seed;
+    unsigned long nonce = rec->nonce;
+    unsigned char *e_map = ctx->e_map;
+    int ret;
+
+    xlock_record_params(rec, &params);
+    if (memcmp(&params, &ctx->params, sizeof(struct xlock_params)))
+    {
+#ifdef _DEBUG_
+        printf("error: record parameters differ from the context ones\n");
+#endif
+        memset(key, 0, bits_to_bytes(ctx->params.key_bits));
+        return -1;
+    }
+
+    /* seeds are copied, as rep may write them back */
+    if (rec->e_map)
+        xlock_ctx_set_reliability(ctx, xlock_record_e_map(rec));
+    ret = xlock_ctx_rep(ctx, read, &source_seed, xlock_record_vault(rec), key, &key_seed, &nonce, xlock_record_token(rec));
+    xlock_ctx_set_reliability(ctx, e_map);
+
+    return ret;
+}
@@ -0,0 +1,401 @@
+/**
+ * @file sim.c
+ * @brief Monte Carlo estimation of the key failure probability
+ *
+ * This file implements the X-Lock simulator. Since lock() and unlock()
+ * are linear in the source, a trial enrolls an all-zero source: every
+ * lock of a bit-locker then holds its pool bit, and the reading is the
+ * noise alone. This skips the index generation of enrollment while
+ * unlocking exactly as rep does.
+ *
+ * The bit-sliced kernel runs 64 trials at once against one pair of
+ * seeds. Bit t of every word belongs to trial t, so each XOR-ation and
+ * each step of the vote counter serves the 64 trials.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <math.h>
+#include <unistd.h>
+#include <pthread.h>
+
+#include "../include/bits.h"
+#include "../include/indexes.h"
+#include "../include/xlock.h"
+#include "../include/context.h"
+#include "../include/sim.h"
+
+/**
+ * @brief number of trials a thread claims at a time
+ */
+#define SIM_CHUNK 256
+
+/**
+ * @brief first stream position of the pool, after the two seeds
+ */
+#define SIM_POOL 2
+
+/**
+ * @brief stream position of the noise key
+ *
+ * Pools are far shorter, so the noise key never is a pool word.
+ */
+#define SIM_NOISE (1ULL << 32)
+
+/**
+ * @brief trials of the bit-sliced kernel sharing a pair of seeds
+ */
+#define SIM_SLICE 64
+
+/**
+ * @brief largest number of bit planes of the vote counter
+ */
+#define SIM_PLANES 32
+
+struct sim_thread;
+
+/**
+ * @brief simulation shared by the threads
+ */
+struct sim_job
+{
+    struct xlock_params params; /**< X-Lock parameters */
+    float e_abs;                /**< absolute error probability */
+    uint32_t thres;             /**< e_abs as a noise_word() threshold */
+    uint64_t trials;            /**< number of trials */
+    uint64_t seed;              /**< base seed */
+    uint64_t next;              /**< next unclaimed trial */
+    void (*kernel)(struct sim_thread *t, uint64_t i, uint64_t end); /**< runs trials [i, end) */
+};
+
+/**
+ * @brief thread of a simulation
+ */
+struct sim_thread
+{
+    struct sim_job *job;  /**< shared simulation */
+    pthread_t thread;     /**< thread */
+    struct xlock_ctx ctx; /**< context of the thread */
+    unsigned char *read;  /**< reading scratch */
+    unsigned char *pool;  /**< pool scratch */
+    unsigned char *vault; /**< vault scratch */
+    uint64_t failures;    /**< failed trials of the thread */
+    uint64_t bits;        /**< wrong key_pre bits of the thread */
+    int ret;              /**< 0 on success, -1 if memory is short */
+};
+
+/**
+ * @brief fills b from a PRNG stream
+ *
+ * @param key stream key
+ * @param n position of the first output
+ * @param b array of bytes
+ * @param size size of b in bytes
+ * @return void
+ */
+void sim_fill(uint64_t key, uint64_t n, unsigned char *b, unsigned int size)
+{
+    unsigned int i;
+    uint64_t r = 0;
+
+    for (i = 0; i < size; i++)
+    {
+        if (!(i % 8))
+            r = prng_counter(key, n + i / 8);
+        b[i] = (unsigned char)(r >> (8 * (i % 8)));
+    }
+}
+
+/**
+ * @brief builds the vault of an all-zero source
+ *
+ * @param params X-Lock parameters
+ * @param pool random pool
+ * @param vault encrypted vault
+ * @return void
+ */
+void sim_lock(struct xlock_params *params, unsigned char *pool, unsigned char *vault)
+{
+    unsigned int i, j, n;
+    uint64_t v;
+
+    for (i = 0; i < params->pool_bits; i++)
+    {
+        v = get_bit(pool, i) ? ~0ULL : 0;
+        for (j = 0; j < params->n_locks; j += n)
+        {
+            n = params->n_locks - j < 64 ? params->n_locks - j : 64;
+            set_bits(vault, i * params->n_locks + j, n, v);
+        }
+    }
+}
+
+/**
+ * @brief runs trials one at a time
+ *
+ * @param t thread
+ * @param i first trial
+ * @param end last trial, excluded
+ * @return void
+ */
+void sim_kernel(struct sim_thread *t, uint64_t i, uint64_t end)
+{
+    struct sim_job *job = t->job;
+    struct xlock_params *params = &job->params;
+    unsigned long source_seed, key_seed;
+    unsigned int errors;
+    uint64_t key;
+
+    for (; i < end; i++)
+    {
+        /* the stream of trial i, seeds must not be 0 */
+        key = prng_counter(job->seed, i);
+        source_seed = prng_counter(key, 0) | 1;
+        key_seed = prng_counter(key, 1) | 1;
+        sim_fill(key, SIM_POOL, t->pool, bits_to_bytes(params->pool_bits));
+        sim_lock(params, t->pool, t->vault);
+        noise_uniform(prng_counter(key, SIM_NOISE), t->read, bits_to_bytes(params->source_bits), job->e_abs);
+
+        errors = xlock_ctx_key_pre_errors(&t->ctx, t->read, &source_seed, t->vault, &key_seed, t->pool);
+        t->failures += errors != 0;
+        t->bits += errors;
+    }
+}
+
+/**
+ * @brief runs trials 64 at a time
+ *
+ * Trials [64 g, 64 g + 64) share the seeds of group g and each own a
+ * pool bit and a noise bit in every word. The votes of a bit-locker are
+ * summed in a bit-sliced counter and compared with n_locks / 2 as
+ * unlock() does.
+ *
+ * @param t thread
+ * @param i first trial, a multiple of 64
+ * @param end last trial, excluded
+ * @return void
+ */
+void sim_kernel64(struct sim_thread *t, uint64_t i, uint64_t end)
+{
+    struct sim_job *job = t->job;
+    struct xlock_params *params = &job->params;
+    unsigned int di = params->n_locks * params->n_xoration;
+    unsigned int mid = params->n_locks / 2;
+    unsigned int planes = 0, b, l, j, c, s;
+    uint64_t cnt[SIM_PLANES], key, noise, mask, pool, w, carry, gt, eq, e, fail;
+    unsigned long source_seed, key_seed;
+
+    while (planes < SIM_PLANES && params->n_locks >> planes)
+        planes++;
+
+    for (; i < end; i += SIM_SLICE)
+    {
+        /* the stream of group i / 64, seeds must not be 0 */
+        key = prng_counter(~job->seed, i / SIM_SLICE);
+        source_seed = prng_counter(key, 0) | 1;
+        key_seed = prng_counter(key, 1) | 1;
+        noise = prng_counter(key, SIM_NOISE);
+        mask = end - i < SIM_SLICE ? (1ULL << (end - i)) - 1 : ~0ULL;
+        xlock_indexes(params, &source_seed, &key_seed, t->ctx.key_indexes, t->ctx.source_indexes);
+
+        fail = 0;
+        for (l = 0; l < params->key_pre_bits; l++)
+        {
+            pool = prng_counter(key, SIM_POOL + l);
+
+            memset(cnt, 0, planes * sizeof(uint64_t));
+            for (j = 0; j < params->n_locks; j++)
+            {
+                /* lock j reads pool ^ noise of its XOR-ation */
+                w = pool;
+                for (c = 0; c < params->n_xoration; c++)
+                {
+                    s = xlock_index_get(t->ctx.index_bytes, t->ctx.source_indexes, l * di + j * params->n_xoration + c);
+                    w ^= noise_word(noise, s, job->thres);
+                }
+
+                /* cnt += w, a ripple-carry add per trial */
+                for (b = 0, carry = w; carry && b < planes; b++)
+                {
+                    w = cnt[b] & carry;
+                    cnt[b] ^= carry;
+                    carry = w;
+                }
+            }
+
+            /* the bit-locker decodes to 1 where cnt > mid */
+            gt = 0;
+            eq = ~0ULL;
+            for (b = planes; b-- > 0;)
+            {
+                if (mid >> b & 1)
+                {
+                    eq &= cnt[b];
+                }
+                else
+                {
+                    gt |= eq & cnt[b];
+                    eq &= ~cnt[b];
+                }
+            }
+
+            e = (gt ^ pool) & mask;
+            fail |= e;
+            t->bits += popcount64(e);
+        }
+        t->failures += popcount64(fail);
+    }
+}
+
+/**
+ * @brief runs trials until none is left
+ *
+ * @param arg thread
+ * @return NULL
+ */
+void *sim_main(void *arg)
+{
+    struct sim_thread *t = arg;
+    struct sim_job *job = t->job;
+    struct xlock_params *params = &job->params;
+    uint64_t i, end;
+
+    size_t scratch = xlock_ctx_size(params);
+    unsigned char *buf = malloc(scratch);
+    t->read = malloc(bits_to_bytes(params->source_bits));
+    t->pool = malloc(bits_to_bytes(params->pool_bits));
+    t->vault = malloc(bits_to_bytes(params->pool_bits * params->n_locks));
+
+    t->ret = -1;
+    if (!buf || !t->read || !t->pool || !t->vault || xlock_ctx_init(&t->ctx, params, buf, scratch))
+        goto out;
+
+    /* chunks are multiples of SIM_SLICE, as sim_kernel64() expects */
+    while ((i = __atomic_fetch_add(&job->next, SIM_CHUNK, __ATOMIC_RELAXED)) < job->trials)
+    {
+        end = job->trials - i < SIM_CHUNK ? job->trials : i + SIM_CHUNK;
+        job->kernel(t, i, end);
+    }
+    t->ret = 0;
+
+out:
+    free(t->vault);
+    free(t->pool);
+    free(t->read);
+    free(buf);
+    return NULL;
+}
+
+/**
+ * @brief runs a simulation with a kernel
+ *
+ * @param params X-Lock parameters
+ * @param e_abs absolute error probability
+ * @param trials number of trials
+ * @param n_threads number of threads, 0 for one per online CPU
+ * @param seed base seed
+ * @param z normal quantile of the confidence level
+ * @param kernel trial kernel
+ * @param res storage for the outcome
+ * @return 0 on success, -1 if params are invalid or the threads could
+ * not be started
+ * @see xlock_sim_run
+ */
+int sim_run(
+    struct xlock_params *params,
+    float e_abs,
+    uint64_t trials,
+    unsigned int n_threads,
+    uint64_t seed,
+    double z,
+    void (*kernel)(struct sim_thread *t, uint64_t i, uint64_t end),
+    struct xlock_sim_result *res)
+{
+    struct sim_job job = {*params, e_abs, noise_thres(e_abs), trials, seed, 0, kernel};
+    struct sim_thread *threads;
+    unsigned int i, started;
+    double p, n, c, h;
+    int ret = 0;
+    long cpus;
+
+    /* validated once here, rather than by every thread sizing its scratch */
+    if (xlock_params_check(params))
+        return -1;
+
+    if (!n_threads)
+    {
+        cpus = sysconf(_SC_NPROCESSORS_ONLN);
+        n_threads = cpus > 0 ? (unsigned int)cpus : 1;
+    }
+
+    threads = calloc(n_threads, sizeof(struct sim_thread));
+    if (!threads)
+        return -1;
+
+    for (started = 0; started < n_threads; started++)
+    {
+        threads[started].job = &job;
+        if (pthread_create(&threads[started].thread, NULL, sim_main, &threads[started]))
+            break;
+    }
+
+    /* sums do not depend on which thread ran which trial */
+    memset(res, 0, sizeof(struct xlock_sim_result));
+    for (i = 0; i < started; i++)
+    {
+        pthread_join(threads[i].thread, NULL);
+        ret |= threads[i].ret;
+        res->failures += threads[i].failures;
+        res->bits += threads[i].bits;
+    }
+    free(threads);
+
+    if (!started || ret)
+    {
+#ifdef _DEBUG_
+        printf("error: simulation could not run\n");
+#endif
+        return -1;
+    }
+
+    /* Wilson score interval */
+    res->trials = trials;
+    n = trials;
+    p = n ? res->failures / n : 0;
+    res->p = p;
+    if (n)
+    {
+        c = (p + z * z / (2 * n)) / (1 + z * z / n);
+        h = z * sqrt(p * (1 - p) / n + z * z / (4 * n * n)) / (1 + z * z / n);
+        res->lo = c - h > 0 ? c - h : 0;
+        res->hi = c + h < 1 ? c + h : 1;
+    }
+
+    return 0;
+}
+
+int xlock_sim_run(
+    struct xlock_params *params,
+    float e_abs,
+    uint64_t trials,
+    unsigned int n_threads,
+    uint64_t seed,
+    double z,
+    struct xlock_sim_result *res)
+{
+    return sim_run(params, e_abs, trials, n_threads, seed, z, sim_kernel, res);
+}
+
+int xlock_sim_run64(
+    struct xlock_params *params,
+    float e_abs,
+    uint64_t trials,
+    unsigned int n_threads,
+    uint64_t seed,
+    double z,
+    struct xlock_sim_result *res)
+{
+    return sim_run(params, e_abs, trials, n_threads, seed, z, sim_kernel64, res);
+}
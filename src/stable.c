@@ -0,0 +1,164 @@
+/**
+ * @file stable.c
+ * @brief Rank/select over the stable bits of a source
+ *
+ * This file implements the rank/select structure of X-Lock. Select
+ * starts from the sampled word of its rank, moves to the word holding
+ * the stable bit, then selects within the word with BMI2 where the CPU
+ * has it, by halving otherwise.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../include/bits.h"
+#include "../include/xlock.h"
+#include "../include/stable.h"
+
+#ifdef GATHER_X86
+#include <immintrin.h>
+#endif
+
+/**
+ * @brief stable bits between two samples of select
+ */
+#define STABLE_SAMPLE 64
+
+/**
+ * @brief alignment of the arrays of the structure
+ */
+#define STABLE_ALIGN 8
+
+/**
+ * @brief Returns n rounded up to a multiple of STABLE_ALIGN.
+ */
+#define STABLE_ROUND(n) (((n) + STABLE_ALIGN - 1) / STABLE_ALIGN * STABLE_ALIGN)
+
+unsigned int stable_select64(uint64_t w, unsigned int k)
+{
+    unsigned int pos = 0, s, c, m;
+
+    /* keep the half holding the bit, six times, without branches */
+    for (s = 32; s; s >>= 1)
+    {
+        c = popcount64(w & ((1ULL << s) - 1));
+        m = -(unsigned int)(k >= c);
+        k -= c & m;
+        w >>= s & m;
+        pos += s & m;
+    }
+
+    return pos;
+}
+
+#ifdef GATHER_X86
+
+__attribute__((target("bmi,bmi2")))
+unsigned int stable_select64_bmi2(uint64_t w, unsigned int k)
+{
+    /* depositing bit k into the bits of w leaves only the kth bit set */
+    return (unsigned int)_tzcnt_u64(_pdep_u64(1ULL << k, w));
+}
+
+#endif
+
+unsigned int xlock_stable_bitmap(unsigned char *e_map, unsigned int source_bits, unsigned char e_max, unsigned char *bitmap)
+{
+    unsigned int i, n = 0;
+
+    memset(bitmap, 0, bits_to_bytes(source_bits));
+    for (i = 0; i < source_bits; i++)
+    {
+        if (e_map[i] <= e_max)
+        {
+            set_bit_v(bitmap, i, 1);
+            n++;
+        }
+    }
+
+    return n;
+}
+
+size_t xlock_stable_size(unsigned int source_bits)
+{
+    size_t words = ((size_t)source_bits + 63) / 64;
+
+    /* at most one sample per word, plus a sentinel */
+    return STABLE_ALIGN - 1 +
+           STABLE_ROUND(words * sizeof(uint64_t)) +
+           STABLE_ROUND((words + 1) * sizeof(uint32_t)) +
+           STABLE_ROUND((words + 1) * sizeof(uint32_t));
+}
+
+int xlock_stable_init(
+    struct xlock_stable *stable,
+    unsigned char *bitmap,
+    unsigned int source_bits,
+    void *buf,
+    size_t size)
+{
+    size_t words = ((size_t)source_bits + 63) / 64;
+    unsigned char *p;
+    unsigned int w, n, c, k;
+
+    if (!source_bits || !buf || size < xlock_stable_size(source_bits))
+    {
+#ifdef _DEBUG_
+        printf("error: stable buffer smaller than %zu bytes\n", xlock_stable_size(source_bits));
+#endif
+        return -1;
+    }
+
+    p = (unsigned char *)STABLE_ROUND((uintptr_t)buf);
+    stable->source_bits = source_bits;
+    stable->bits = (uint64_t *)p;
+    p += STABLE_ROUND(words * sizeof(uint64_t));
+    stable->rank = (uint32_t *)p;
+    p += STABLE_ROUND((words + 1) * sizeof(uint32_t));
+    stable->samples = (uint32_t *)p;
+    stable->select64 = stable_select64;
+#ifdef GATHER_X86
+    if (__builtin_cpu_supports("bmi2"))
+        stable->select64 = stable_select64_bmi2;
+#endif
+
+    /* the sample of rank k is the word where stable bit k lies */
+    c = 0;
+    stable->span = 0;
+    for (w = 0; w < words; w++)
+    {
+        n = source_bits - w * 64 < 64 ? source_bits - w * 64 : 64;
+        stable->bits[w] = get_bits(bitmap, w * 64, n);
+        stable->rank[w] = c;
+        n = popcount64(stable->bits[w]);
+        for (k = CEIL(c, STABLE_SAMPLE) * STABLE_SAMPLE; k < c + n; k += STABLE_SAMPLE)
+            stable->samples[k / STABLE_SAMPLE] = w;
+
+        /* the first stable bit of the word has the farthest sample */
+        if (n && w - stable->samples[c / STABLE_SAMPLE] > stable->span)
+            stable->span = w - stable->samples[c / STABLE_SAMPLE];
+        c += n;
+    }
+    stable->rank[words] = c;
+    stable->n_stable = c;
+
+    return 0;
+}
+
+unsigned int xlock_stable_rank(struct xlock_stable *stable, unsigned int i)
+{
+    unsigned int w = i / 64;
+
+    return stable->rank[w] + (i % 64 ? popcount64(stable->bits[w] & ((1ULL << i % 64) - 1)) : 0);
+}
+
+unsigned int xlock_stable_select(struct xlock_stable *stable, unsigned int k)
+{
+    unsigned int w = stable->samples[k / STABLE_SAMPLE];
+
+    while (stable->rank[w + 1] <= k)
+        w++;
+
+    return w * 64 + stable->select64(stable->bits[w], k - stable->rank[w]);
+}
@@ -0,0 +1,244 @@
+/**
+ * @file stats.c
+ * @brief Per-phase latency counters
+ *
+ * This file implements the per-thread phase counters of X-Lock. Every
+ * thread links its counters in a process-wide list on first use, so
+ * that xlock_stats_total() can sum them, and folds them into a retired
+ * total when it exits.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <pthread.h>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+#include "../include/stats.h"
+#include "../include/tictoc.h"
+
+/**
+ * @brief counters of a thread
+ */
+struct stats_thread
+{
+    struct xlock_stats stats;  /**< counters of the thread */
+    struct stats_thread *prev; /**< previous thread in stats_threads */
+    struct stats_thread *next; /**< next thread in stats_threads */
+    int linked;                /**< the thread is in stats_threads */
+};
+
+/**
+ * @brief counters are recorded
+ */
+static int stats_on;
+
+/**
+ * @brief threads with counters
+ */
+static struct stats_thread *stats_threads;
+
+/**
+ * @brief counters of the exited threads
+ */
+static struct xlock_stats stats_retired;
+
+/**
+ * @brief protects stats_threads and stats_retired
+ */
+static pthread_mutex_t stats_lock = PTHREAD_MUTEX_INITIALIZER;
+
+/**
+ * @brief guards the creation of stats_key
+ */
+static pthread_once_t stats_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief unlinks the counters of an exiting thread
+ */
+static pthread_key_t stats_key;
+
+/**
+ * @brief counters of the calling thread
+ */
+static __thread struct stats_thread stats_local;
+
+/**
+ * @brief names of the phases
+ */
+static const char *stats_names[XLOCK_PHASES] = {"indexes", "unlock", "key", "token"};
+
+/**
+ * @brief adds src to dst
+ *
+ * Every counter of src is read atomically, since its thread may be
+ * updating it.
+ *
+ * @param dst counters to increase
+ * @param src counters to add
+ * @return void
+ */
+void stats_add(struct xlock_stats *dst, struct xlock_stats *src)
+{
+    unsigned int i;
+
+    for (i = 0; i < XLOCK_PHASES; i++)
+    {
+        dst->phases[i].runs += __atomic_load_n(&src->phases[i].runs, __ATOMIC_RELAXED);
+        dst->phases[i].ns += __atomic_load_n(&src->phases[i].ns, __ATOMIC_RELAXED);
+        dst->phases[i].cycles += __atomic_load_n(&src->phases[i].cycles, __ATOMIC_RELAXED);
+    }
+}
+
+/**
+ * @brief folds the counters of an exiting thread into stats_retired
+ *
+ * @param arg counters of the thread
+ * @return void
+ */
+void stats_retire(void *arg)
+{
+    struct stats_thread *t = arg;
+
+    pthread_mutex_lock(&stats_lock);
+    stats_add(&stats_retired, &t->stats);
+    if (t->prev)
+        t->prev->next = t->next;
+    else
+        stats_threads = t->next;
+    if (t->next)
+        t->next->prev = t->prev;
+    t->linked = 0;
+    pthread_mutex_unlock(&stats_lock);
+}
+
+/**
+ * @brief creates stats_key
+ *
+ * @return void
+ */
+void stats_setup(void)
+{
+    pthread_key_create(&stats_key, stats_retire);
+}
+
+/**
+ * @brief links the counters of the calling thread in stats_threads
+ *
+ * @return void
+ */
+void stats_link(void)
+{
+    pthread_once(&stats_once, stats_setup);
+
+    pthread_mutex_lock(&stats_lock);
+    stats_local.prev = NULL;
+    stats_local.next = stats_threads;
+    if (stats_threads)
+        stats_threads->prev = &stats_local;
+    stats_threads = &stats_local;
+    stats_local.linked = 1;
+    pthread_mutex_unlock(&stats_lock);
+
+    pthread_setspecific(stats_key, &stats_local);
+}
+
+/**
+ * @brief returns the time stamp counter
+ *
+ * @return the time stamp counter, 0 if unavailable
+ */
+uint64_t stats_cycles(void)
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return 0;
+#endif
+}
+
+/**
+ * @brief returns the monotonic time
+ *
+ * @return the monotonic time in nanoseconds
+ */
+uint64_t stats_ns(void)
+{
+    struct timespec t;
+
+    TIC(t);
+    return (uint64_t)t.tv_sec * 1000000000 + t.tv_nsec;
+}
+
+void xlock_stats_enable(int enable)
+{
+    __atomic_store_n(&stats_on, enable, __ATOMIC_RELAXED);
+}
+
+void xlock_stats_thread(struct xlock_stats *stats)
+{
+    *stats = stats_local.stats;
+}
+
+void xlock_stats_total(struct xlock_stats *stats)
+{
+    struct stats_thread *t;
+
+    pthread_mutex_lock(&stats_lock);
+    *stats = stats_retired;
+    for (t = stats_threads; t; t = t->next)
+    {
+        stats_add(stats, &t->stats);
+    }
+    pthread_mutex_unlock(&stats_lock);
+}
+
+void xlock_stats_reset(void)
+{
+    unsigned int i;
+
+    for (i = 0; i < XLOCK_PHASES; i++)
+    {
+        __atomic_store_n(&stats_local.stats.phases[i].runs, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats_local.stats.phases[i].ns, 0, __ATOMIC_RELAXED);
+        __atomic_store_n(&stats_local.stats.phases[i].cycles, 0, __ATOMIC_RELAXED);
+    }
+}
+
+const char *xlock_phase_name(enum xlock_phase phase)
+{
+    return phase < XLOCK_PHASES ? stats_names[phase] : "unknown";
+}
+
+void xlock_probe_start(struct xlock_probe *probe)
+{
+    probe->on = __atomic_load_n(&stats_on, __ATOMIC_RELAXED);
+    if (!probe->on)
+        return;
+
+    probe->ns = stats_ns();
+    probe->cycles = stats_cycles();
+}
+
+void xlock_probe_stop(struct xlock_probe *probe, enum xlock_phase phase)
+{
+    struct xlock_phase_stats *p = &stats_local.stats.phases[phase];
+    uint64_t cycles, ns;
+
+    if (!probe->on)
+        return;
+
+    cycles = stats_cycles() - probe->cycles;
+    ns = stats_ns() - probe->ns;
+    if (!stats_local.linked)
+        stats_link();
+
+    /* only this thread writes its counters, other threads may read them */
+    __atomic_store_n(&p->runs, p->runs + 1, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->ns, p->ns + ns, __ATOMIC_RELAXED);
+    __atomic_store_n(&p->cycles, p->cycles + cycles, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,248 @@
+/**
+ * @file store.c
+ * @brief Memory-mapped helper data store
+ *
+ * This file implements the helper data store of X-Lock. Device IDs are
+ * hashed with the counter PRNG and looked up by linear probing.
+ */
+
+#include <stdio.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "../include/bits.h"
+#include "../include/indexes.h"
+#include "../include/context.h"
+#include "../include/record.h"
+#include "../include/store.h"
+
+/**
+ * @brief Returns n rounded up to a multiple of XLOCK_RECORD_ALIGN.
+ */
+#define STORE_ROUND(n) (((n) + XLOCK_RECORD_ALIGN - 1) / XLOCK_RECORD_ALIGN * XLOCK_RECORD_ALIGN)
+
+/**
+ * @brief returns the slot of a device, or the free slot it would take
+ *
+ * @param store store
+ * @param device_id device ID
+ * @return the slot holding device_id, otherwise the first free slot of
+ * its probe sequence, NULL if the table is full
+ */
+struct xlock_store_slot *store_find(struct xlock_store *store, uint64_t device_id)
+{
+    uint64_t mask = store->header->slots - 1;
+    uint64_t i = prng_counter(device_id, 0) & mask;
+    uint64_t n;
+
+    for (n = 0; n <= mask; n++, i = (i + 1) & mask)
+    {
+        if (!store->slots[i].offset || store->slots[i].device_id == device_id)
+            return &store->slots[i];
+    }
+
+    return NULL;
+}
+
+/**
+ * @brief maps an open store file
+ *
+ * @param store store, with fd and writable set
+ * @param size file length
+ * @return 0 on success, -1 otherwise
+ */
+int store_map(struct xlock_store *store, size_t size)
+{
+    void *map = mmap(
+        NULL, size, store->writable ? PROT_READ | PROT_WRITE : PROT_READ,
+        MAP_SHARED, store->fd, 0);
+
+    if (map == MAP_FAILED)
+    {
+#ifdef _DEBUG_
+        printf("error: cannot map %zu bytes of store\n", size);
+#endif
+        return -1;
+    }
+
+    store->map = map;
+    store->header = map;
+    store->slots = (struct xlock_store_slot *)(store->map + store->header->index);
+    return 0;
+}
+
+int xlock_store_create(struct xlock_store *store, const char *path, uint64_t max_devices, size_t record_bytes)
+{
+    struct xlock_store_header header;
+    uint64_t slots = 1, record = STORE_ROUND((uint64_t)record_bytes);
+
+    /* records hold 32-bit sizes, and every length below fits 64 bits */
+    if (!max_devices || max_devices > UINT64_MAX / 8 / sizeof(struct xlock_store_slot) ||
+        !record_bytes || record_bytes > UINT32_MAX ||
+        max_devices > (UINT64_MAX / 2) / record)
+    {
+#ifdef _DEBUG_
+        printf("error: store of %llu devices of %zu bytes is too large\n",
+               (unsigned long long)max_devices, record_bytes);
+#endif
+        return -1;
+    }
+
+    while (slots < 2 * max_devices)
+        slots <<= 1;
+
+    memset(&header, 0, sizeof(header));
+    header.magic = XLOCK_STORE_MAGIC;
+    header.version = XLOCK_STORE_VERSION;
+    header.slots = slots;
+    header.index = STORE_ROUND(sizeof(struct xlock_store_header));
+    header.records = header.index + slots * sizeof(struct xlock_store_slot);
+    header.used = header.records;
+    header.size = header.records + max_devices * record;
+
+    memset(store, 0, sizeof(struct xlock_store));
+    store->writable = 1;
+    store->fd = open(path, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (store->fd < 0)
+        return -1;
+
+    /* the slot table and the records start zeroed, hence free */
+    if (ftruncate(store->fd, header.size) ||
+        pwrite(store->fd, &header, sizeof(header), 0) != sizeof(header) ||
+        store_map(store, header.size))
+    {
+        close(store->fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+int xlock_store_open(struct xlock_store *store, const char *path, int writable)
+{
+    struct xlock_store_header header;
+    struct stat st;
+
+    memset(store, 0, sizeof(struct xlock_store));
+    store->writable = writable;
+    store->fd = open(path, writable ? O_RDWR : O_RDONLY);
+    if (store->fd < 0)
+        return -1;
+
+    if (fstat(store->fd, &st) ||
+        pread(store->fd, &header, sizeof(header), 0) != sizeof(header) ||
+        header.magic != XLOCK_STORE_MAGIC || header.version != XLOCK_STORE_VERSION ||
+        !header.slots || header.slots & (header.slots - 1) ||
+        header.size != (uint64_t)st.st_size ||
+        header.index % XLOCK_RECORD_ALIGN || header.index < sizeof(header) || header.index > header.size ||
+        /* bounded before multiplying, so that no length wraps around */
+        header.slots > (header.size - header.index) / sizeof(struct xlock_store_slot) ||
+        header.records != header.index + header.slots * sizeof(struct xlock_store_slot) ||
+        header.records > header.used || header.used > header.size ||
+        header.used % XLOCK_RECORD_ALIGN)
+    {
+#ifdef _DEBUG_
+        printf("error: %s is not a valid store\n", path);
+#endif
+        close(store->fd);
+        return -1;
+    }
+
+    if (store_map(store, header.size))
+    {
+        close(store->fd);
+        return -1;
+    }
+
+    return 0;
+}
+
+int xlock_store_put(struct xlock_store *store, uint64_t device_id, struct xlock_record *rec)
+{
+    struct xlock_store_header *header = store->header;
+    struct xlock_store_slot *slot;
+    struct xlock_record *old;
+    uint64_t size = STORE_ROUND((uint64_t)rec->size);
+
+    if (!store->writable || xlock_record_check(rec, rec->size) || !(slot = store_find(store, device_id)))
+        return -1;
+
+    /* a record of the same size replaces the old one in place */
+    if (slot->offset && slot->offset >= header->records && slot->offset < header->used &&
+        !(slot->offset % XLOCK_RECORD_ALIGN) && header->used - slot->offset >= rec->size)
+    {
+        old = (struct xlock_record *)(store->map + slot->offset);
+        if (old->size == rec->size)
+        {
+            memcpy(old, rec, rec->size);
+            return 0;
+        }
+    }
+
+    if (header->size - header->used < size)
+    {
+#ifdef _DEBUG_
+        printf("error: store is full\n");
+#endif
+        return -1;
+    }
+
+    memcpy(store->map + header->used, rec, rec->size);
+    if (!slot->offset)
+        header->count++;
+    slot->device_id = device_id;
+    slot->offset = header->used;
+    header->used += size;
+
+    return 0;
+}
+
+struct xlock_record *xlock_store_get(struct xlock_store *store, uint64_t device_id)
+{
+    struct xlock_store_slot *slot = store_find(store, device_id);
+    struct xlock_record *rec;
+
+    if (!slot || !slot->offset || slot->offset < store->header->records ||
+        slot->offset >= store->header->used)
+        return NULL;
+
+    rec = (struct xlock_record *)(store->map + slot->offset);
+    if (xlock_record_check(rec, store->header->used - slot->offset))
+        return NULL;
+
+    return rec;
+}
+
+int xlock_store_rep(
+    struct xlock_ctx *ctx,
+    struct xlock_store *store,
+    uint64_t device_id,
+    unsigned char *read,
+    unsigned char *key)
+{
+    struct xlock_record *rec = xlock_store_get(store, device_id);
+
+    if (!rec)
+    {
+        memset(key, 0, bits_to_bytes(ctx->params.key_bits));
+        return -1;
+    }
+
+    return xlock_record_rep(ctx, rec, read, key);
+}
+
+void xlock_store_close(struct xlock_store *store)
+{
+    size_t size = store->header->size;
+
+    if (store->writable)
+        msync(store->map, size, MS_SYNC);
+    munmap(store->map, size);
+    close(store->fd);
+    memset(store, 0, sizeof(struct xlock_store));
+    store->fd = -1;
+}
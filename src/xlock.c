@@ -8,23 +8,104 @@
 
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdint.h>
 #include <limits.h>
 #include <string.h>
 #include <math.h>
-#include <openssl/hmac.h>
-#include <openssl/evp.h>
-#include <openssl/sha.h>
+#include <pthread.h>
 
 #include "../include/bits.h"
 #include "../include/tictoc.h"
 #include "../include/indexes.h"
+#include "../include/gather.h"
+#include "../include/profile.h"
 #include "../include/xlock.h"
+#include "../include/context.h"
+
+/**
+ * @brief soft-decision cost units per nat
+ */
+#define SOFT_SCALE 16
+
+/**
+ * @brief number of entries of the lock weight table
+ */
+#define SOFT_COSTS 1024
+
+/**
+ * @brief soft-decision vote units per nat
+ */
+#define SOFT_WEIGHT 64
+
+/**
+ * @brief cost of a source bit, indexed by its error probability in 1/256
+ *
+ * The cost is -ln(1 - 2 e) in 1/SOFT_SCALE nats, so that the costs of
+ * the bits of a XOR-ation add up to -ln(1 - 2 e) of the XOR-ation.
+ */
+static unsigned short soft_cost[256];
+
+/**
+ * @brief vote weight of a lock, indexed by the cost of its XOR-ation
+ *
+ * The weight is the log-likelihood ratio ln((1 - e) / e) of the lock,
+ * in 1/SOFT_WEIGHT nats.
+ */
+static unsigned short soft_weight[SOFT_COSTS];
+
+/**
+ * @brief guards the computation of soft_cost and soft_weight
+ */
+static pthread_once_t soft_once = PTHREAD_ONCE_INIT;
+
+/**
+ * @brief stream positions reserved for each noise word
+ */
+#define NOISE_PLANES 32
+
+/**
+ * @brief number of locks evaluated per word
+ */
+#define LOCK_WORD_BITS 64
+
+/**
+ * @brief number of locks evaluated between two early-exit checks
+ */
+#define EARLY_EXIT_LOCKS 16
+
+/**
+ * @brief number of bit-lockers locked at a time by init()
+ */
+#define ENROLL_LOCKERS 8
+
+/**
+ * @brief number of bit planes of the read counters, so at most 65535 reads
+ */
+#define COUNT_PLANES 16
 
 unsigned char get_bit(unsigned char *b, int i)
 {
     return (unsigned char)((b[i / 8] >> i % 8) & 1);
 }
 
+uint64_t get_bits(unsigned char *b, unsigned int i, unsigned int n)
+{
+    uint64_t v = 0;
+    unsigned int t, s = i % 8, bytes = bits_to_bytes(s + n);
+    unsigned char *p = b + i / 8;
+
+    for (t = 0; t < bytes && t < 8; t++)
+    {
+        v |= (uint64_t)p[t] << (8 * t);
+    }
+    v >>= s;
+    if (bytes > 8)
+    {
+        v |= (uint64_t)p[8] << (64 - s);
+    }
+    return n < 64 ? v & ((1ULL << n) - 1) : v;
+}
+
 /**
  * @brief retrieves the value of a bit in a 2-D array
 
@@ -96,17 +177,6 @@ unsigned int get_int_3D(
     return b[i * di + j * kk + k];
 }
 
-/**
- * @brief sets the value of a bit in a 1-D array
-
- * This function sets the value of the bit in position i
- * in a 1-D array of bits.
- *
- * @param b array of bits
- * @param i bit position
- * @param v bit value
- * @return void
- */
 void set_bit_v(
     unsigned char *b,
     int i,
@@ -118,6 +188,30 @@ void set_bit_v(
     b[t0] = t1;
 }
 
+void set_bits(unsigned char *b, unsigned int i, unsigned int n, uint64_t v)
+{
+    uint64_t m = n < 64 ? (1ULL << n) - 1 : ~0ULL;
+    unsigned int t, off, s = i % 8, bytes = bits_to_bytes(s + n);
+    unsigned char mb, vb, *p = b + i / 8;
+
+    v &= m;
+    for (t = 0; t < bytes; t++)
+    {
+        if (t == 0)
+        {
+            mb = (unsigned char)(m << s);
+            vb = (unsigned char)(v << s);
+        }
+        else
+        {
+            off = 8 * t - s;
+            mb = off < 64 ? (unsigned char)(m >> off) : 0;
+            vb = off < 64 ? (unsigned char)(v >> off) : 0;
+        }
+        p[t] = (p[t] & ~mb) | vb;
+    }
+}
+
 /**
  * @brief sets the value of a bit in a 2-D array
 
@@ -217,25 +311,297 @@ void init_random(unsigned char *b, int size)
         b[i] = rand();
 }
 
+uint64_t noise_word(uint64_t key, uint64_t n, uint32_t thres)
+{
+    uint64_t lt = 0, eq = ~0ULL, r;
+    int k;
+
+    /* compare 64 uniform draws with thres, most significant plane first */
+    for (k = 31; k >= 0 && eq; k--)
+    {
+        r = prng_counter(key, n * NOISE_PLANES + (31 - k));
+        if (thres >> k & 1)
+        {
+            lt |= eq & ~r;
+            eq &= r;
+        }
+        else
+        {
+            eq &= ~r;
+        }
+    }
+
+    return lt;
+}
+
+uint32_t noise_thres(float e_abs)
+{
+    if (e_abs <= 0)
+        return 0;
+    if (e_abs >= 1)
+        return UINT32_MAX;
+    return (uint32_t)(e_abs * 4294967296.0);
+}
+
+void noise_uniform(uint64_t key, unsigned char *noise, int size, float e_abs)
+{
+    uint32_t thres = noise_thres(e_abs);
+    uint64_t w;
+    int i, j;
+
+    for (i = 0; i < size; i += 8)
+    {
+        w = noise_word(key, i / 8, thres);
+        for (j = 0; j < 8 && i + j < size; j++)
+        {
+            noise[i + j] = (unsigned char)(w >> (8 * j));
+        }
+    }
+}
+
+void noise_map(uint64_t key, unsigned char *noise, int size, unsigned char *e_map)
+{
+    unsigned char t;
+    uint64_t r;
+    int i, j;
+
+    for (i = 0; i < size; i++)
+    {
+        /* one 8-bit draw per bit, compared with the map of the bit */
+        r = prng_counter(key, i);
+        t = 0;
+        for (j = 0; j < 8; j++)
+        {
+            t |= ((unsigned char)(r >> (8 * j)) < e_map[8 * i + j]) << j;
+        }
+        noise[i] = t;
+    }
+}
+
+/**
+ * @brief returns a noise stream key drawn from rand()
+ *
+ * @return a key depending only on the rand() state
+ */
+uint64_t noise_key(void)
+{
+    uint64_t key = 0;
+    int i;
+
+    /* rand() may return as few as 15 bits */
+    for (i = 0; i < 5; i++)
+    {
+        key = key << 15 ^ (uint64_t)rand();
+    }
+    return key;
+}
+
 void change_random(
     unsigned char *b,
     unsigned char *out,
     int size,
     float e_abs)
 {
+    int i;
 
-    unsigned char t;
-    unsigned char thres = 256 * e_abs;
-    int i, j;
+    noise_uniform(noise_key(), out, size, e_abs);
     for (i = 0; i < size; i++)
+        out[i] ^= b[i];
+}
+
+void change_random_map(
+    unsigned char *b,
+    unsigned char *out,
+    int size,
+    unsigned char *e_map)
+{
+    int i;
+
+    noise_map(noise_key(), out, size, e_map);
+    for (i = 0; i < size; i++)
+        out[i] ^= b[i];
+}
+
+/**
+ * @brief computes soft_cost and soft_weight
+ *
+ * @return void
+ */
+void soft_setup(void)
+{
+    double e, q;
+    int i;
+
+    for (i = 0; i < 256; i++)
     {
-        t = 0;
-        for (j = 0; j < 8; j++)
+        /* bits never seen flipping keep half a count of doubt */
+        e = (i ? i : 0.5) / 256.0;
+        e = e < 0.5 ? e : 0.5;
+        q = e < 0.5 ? -log(1 - 2 * e) * SOFT_SCALE : SOFT_COSTS;
+        soft_cost[i] = q < SOFT_COSTS ? (unsigned short)(q + 0.5) : SOFT_COSTS;
+    }
+
+    for (i = 0; i < SOFT_COSTS; i++)
+    {
+        /* 1 - 2 e of the lock is exp(-cost), its weight 2 atanh(1 - 2 e) */
+        q = exp(-(i ? i : 0.5) / SOFT_SCALE);
+        q = 2 * atanh(q) * SOFT_WEIGHT;
+        soft_weight[i] = q < USHRT_MAX ? (unsigned short)(q + 0.5) : USHRT_MAX;
+    }
+}
+
+/**
+ * @brief counts, for 64 bits at once, the readings where they are set
+ *
+ * The counts are bit-sliced: bit t of cnt[b] is bit b of the count of
+ * bit t. Every reading thus costs a ripple-carry add over the planes,
+ * whatever the number of bits it holds.
+ *
+ * @param reads n_reads readings
+ * @param n_reads number of readings
+ * @param ref word XORed with every reading, to count flips rather than
+ * ones
+ * @param i position of the first bit
+ * @param n number of bits, at most 64
+ * @param cnt storage for planes count planes
+ * @param planes number of planes, enough to hold n_reads
+ * @return void
+ */
+void count_reads(
+    unsigned char **reads,
+    unsigned int n_reads,
+    uint64_t ref,
+    unsigned int i,
+    unsigned int n,
+    uint64_t *cnt,
+    unsigned int planes)
+{
+    unsigned int r, b;
+    uint64_t w, carry;
+
+    memset(cnt, 0, planes * sizeof(uint64_t));
+    for (r = 0; r < n_reads; r++)
+    {
+        carry = get_bits(reads[r], i, n) ^ ref;
+        for (b = 0; carry && b < planes; b++)
+        {
+            w = cnt[b] & carry;
+            cnt[b] ^= carry;
+            carry = w;
+        }
+    }
+}
+
+/**
+ * @brief returns the number of planes of a counter up to n
+ *
+ * @param n largest count
+ * @return the number of planes
+ */
+unsigned int count_planes(unsigned int n)
+{
+    unsigned int planes = 1;
+
+    while (planes < COUNT_PLANES && n >> planes)
+        planes++;
+    return planes;
+}
+
+/**
+ * @brief returns the count of one bit of bit-sliced counters
+ *
+ * @param cnt count planes
+ * @param planes number of planes
+ * @param t bit
+ * @return the count of bit t
+ */
+unsigned int count_get(uint64_t *cnt, unsigned int planes, unsigned int t)
+{
+    unsigned int b, c = 0;
+
+    for (b = 0; b < planes; b++)
+        c |= (unsigned int)(cnt[b] >> t & 1) << b;
+    return c;
+}
+
+/**
+ * @brief returns the error probability of a bit flipping in flips of n
+ * readings
+ *
+ * This is the Krichevsky-Trofimov estimate, so that no bit is fully
+ * trusted, in 1/256 rounded and clamped to [1, 255].
+ *
+ * @param flips number of flips
+ * @param n number of readings
+ * @return the error probability in 1/256
+ */
+unsigned char count_error(unsigned int flips, unsigned int n)
+{
+    uint64_t e = ((2 * (uint64_t)flips + 1) * 256 + n + 1) / (2 * ((uint64_t)n + 1));
+
+    return e < 1 ? 1 : e > 255 ? 255 : (unsigned char)e;
+}
+
+void reliability_map(
+    unsigned char *source,
+    unsigned char **reads,
+    unsigned int n_reads,
+    int size,
+    unsigned char *e_map)
+{
+    unsigned int planes = count_planes(n_reads), i, n, t;
+    unsigned int bits = bytes_to_bits(size);
+    uint64_t cnt[COUNT_PLANES];
+
+    for (i = 0; i < bits; i += n)
+    {
+        n = bits - i < 64 ? bits - i : 64;
+        count_reads(reads, n_reads, get_bits(source, i, n), i, n, cnt, planes);
+        for (t = 0; t < n; t++)
+            e_map[i + t] = count_error(count_get(cnt, planes, t), n_reads);
+    }
+}
+
+void fuse_reads(
+    unsigned char **reads,
+    unsigned int n_reads,
+    int size,
+    unsigned char *source,
+    unsigned char *e_map)
+{
+    unsigned int planes = count_planes(n_reads), mid = n_reads / 2, i, n, t, b, c;
+    unsigned int bits = bytes_to_bits(size);
+    uint64_t cnt[COUNT_PLANES], gt, eq;
+
+    for (i = 0; i < bits; i += n)
+    {
+        n = bits - i < 64 ? bits - i : 64;
+        count_reads(reads, n_reads, 0, i, n, cnt, planes);
+
+        /* the majority is 1 where the count exceeds n_reads / 2 */
+        gt = 0;
+        eq = ~0ULL;
+        for (b = planes; b-- > 0;)
+        {
+            if (mid >> b & 1)
+            {
+                eq &= cnt[b];
+            }
+            else
+            {
+                gt |= eq & cnt[b];
+                eq &= ~cnt[b];
+            }
+        }
+        set_bits(source, i, n, gt);
+
+        if (!e_map)
+            continue;
+        for (t = 0; t < n; t++)
         {
-            if (((unsigned char)rand()) < thres)
-                t = t | (1 << j);
+            c = count_get(cnt, planes, t);
+            e_map[i + t] = count_error(gt >> t & 1 ? n_reads - c : c, n_reads);
         }
-        out[i] = b[i] ^ t;
     }
 }
 
@@ -278,6 +644,215 @@ void printb(unsigned char *b, int size)
     }
 }
 
+/**
+ * @brief Defines the bit-locker kernels for index type T.
+ *
+ * The kernels are instantiated for 32-bit indexes, with an empty W, and
+ * for 16-bit indexes, with W equal to 16.
+ */
+#define LOCKER_KERNELS(W, T)                                                                                       \
+void lock_range##W(                                                                                                \
+    unsigned char *source,                                                                                         \
+    T *source_indexes,                                                                                             \
+    unsigned char *pool,                                                                                           \
+    unsigned int first,                                                                                            \
+    unsigned int count,                                                                                            \
+    unsigned int n_locks,                                                                                          \
+    unsigned int n_xoration,                                                                                       \
+    unsigned char *vault)                                                                                          \
+{                                                                                                                  \
+    uint64_t b;                                                                                                    \
+    unsigned int i, j, n;                                                                                          \
+    gather##W##_fn gather;                                                                                         \
+    struct profile *p;                                                                                             \
+                                                                                                                   \
+    /* specialized profiles are only built without SIMD gather kernels */                                          \
+    if ((p = profile_select(n_locks, n_xoration)))                                                                 \
+    {                                                                                                              \
+        p->lock##W(source, source_indexes, pool, first, count, vault);                                             \
+        return;                                                                                                    \
+    }                                                                                                              \
+    gather = gather##W##_select();                                                                                 \
+                                                                                                                   \
+    for (i = first; i < first + count; i++)                                                                        \
+    {                                                                                                              \
+        b = get_bit(pool, i) ? ~0ULL : 0;                                                                          \
+        for (j = 0; j < n_locks; j += n)                                                                           \
+        {                                                                                                          \
+            n = n_locks - j < LOCK_WORD_BITS ? n_locks - j : LOCK_WORD_BITS;                                       \
+            set_bits(vault, i * n_locks + j, n, b ^ gather(source, source_indexes, n, n_xoration));                \
+            source_indexes += n * n_xoration;                                                                      \
+        }                                                                                                          \
+    }                                                                                                              \
+}                                                                                                                  \
+                                                                                                                   \
+void enroll##W(                                                                                                    \
+    unsigned char *source,                                                                                         \
+    unsigned long *source_seed,                                                                                    \
+    unsigned int source_bits,                                                                                      \
+    unsigned char *pool,                                                                                           \
+    unsigned int pool_bits,                                                                                        \
+    unsigned char *vault,                                                                                          \
+    unsigned int n_locks,                                                                                          \
+    unsigned int n_xoration,                                                                                       \
+    T *source_indexes,                                                                                             \
+    unsigned int lockers)                                                                                          \
+{                                                                                                                  \
+    unsigned int i, count;                                                                                         \
+    unsigned int di = n_locks * n_xoration;                                                                        \
+                                                                                                                   \
+    for (i = 0; i < pool_bits; i += count)                                                                         \
+    {                                                                                                              \
+        count = pool_bits - i < lockers ? pool_bits - i : lockers;                                                 \
+        prng_rand_permutation##W(source_seed, (size_t)i * di, (size_t)count * di, source_indexes, 0, source_bits); \
+        lock_range##W(source, source_indexes, pool, i, count, n_locks, n_xoration, vault);                         \
+    }                                                                                                              \
+}                                                                                                                  \
+                                                                                                                   \
+void locker_indexes##W(                                                                                            \
+    unsigned long *source_seed,                                                                                    \
+    unsigned int source_bits,                                                                                      \
+    T *key_indexes,                                                                                                \
+    unsigned int key_bits,                                                                                         \
+    unsigned int n_locks,                                                                                          \
+    unsigned int n_xoration,                                                                                       \
+    T *source_indexes)                                                                                             \
+{                                                                                                                  \
+    unsigned int i;                                                                                                \
+    unsigned int di = n_locks * n_xoration;                                                                        \
+                                                                                                                   \
+    for (i = 0; i < key_bits; i++)                                                                                 \
+    {                                                                                                              \
+        prng_rand_permutation##W(                                                                                  \
+            source_seed, (size_t)key_indexes[i] * di, di,                                                          \
+            source_indexes + i * di, 0, source_bits);                                                              \
+    }                                                                                                              \
+}                                                                                                                  \
+                                                                                                                   \
+void unlock##W(                                                                                                    \
+    unsigned char *source,                                                                                         \
+    T *source_indexes,                                                                                             \
+    unsigned char *vault,                                                                                          \
+    unsigned char *key,                                                                                            \
+    T *key_indexes,                                                                                                \
+    unsigned int key_bits,                                                                                         \
+    unsigned int n_locks,                                                                                          \
+    unsigned int n_xoration)                                                                                       \
+{                                                                                                                  \
+    uint64_t word, mask;                                                                                           \
+    unsigned int i, j, n;                                                                                          \
+    unsigned int c;                                                                                                \
+    unsigned int mid = n_locks / 2;                                                                                \
+    unsigned int di = n_locks * n_xoration;                                                                        \
+    gather##W##_fn gather;                                                                                         \
+    struct profile *p;                                                                                             \
+                                                                                                                   \
+    /* specialized profiles are only built without SIMD gather kernels */                                          \
+    if ((p = profile_select(n_locks, n_xoration)))                                                                 \
+    {                                                                                                              \
+        p->unlock##W(source, source_indexes, vault, key, key_indexes, key_bits);                                   \
+        return;                                                                                                    \
+    }                                                                                                              \
+    gather = gather##W##_select();                                                                                 \
+                                                                                                                   \
+    for (i = 0; i < key_bits; i++)                                                                                 \
+    {                                                                                                              \
+        c = 0;                                                                                                     \
+        for (j = 0; j < n_locks; j += n)                                                                           \
+        {                                                                                                          \
+            n = n_locks - j < LOCK_WORD_BITS ? n_locks - j : LOCK_WORD_BITS;                                       \
+            word = get_bits(vault, key_indexes[i] * n_locks + j, n);                                               \
+            mask = gather(source, source_indexes + i * di + j * n_xoration, n, n_xoration);                        \
+            c += popcount64(word ^ mask);                                                                          \
+        }                                                                                                          \
+        set_bit_v(key, i, c > mid);                                                                                \
+    }                                                                                                              \
+}                                                                                                                  \
+                                                                                                                   \
+unsigned long unlock_early##W(                                                                                     \
+    unsigned char *source,                                                                                         \
+    T *source_indexes,                                                                                             \
+    unsigned char *vault,                                                                                          \
+    unsigned char *key,                                                                                            \
+    T *key_indexes,                                                                                                \
+    unsigned int key_bits,                                                                                         \
+    unsigned int n_locks,                                                                                          \
+    unsigned int n_xoration)                                                                                       \
+{                                                                                                                  \
+    uint64_t word = 0, mask;                                                                                       \
+    unsigned int i, j, n;                                                                                          \
+    unsigned int c;                                                                                                \
+    unsigned int mid = n_locks / 2;                                                                                \
+    unsigned int di = n_locks * n_xoration;                                                                        \
+    unsigned long skipped = 0;                                                                                     \
+    gather##W##_fn gather = gather##W##_select();                                                                  \
+                                                                                                                   \
+    for (i = 0; i < key_bits; i++)                                                                                 \
+    {                                                                                                              \
+        c = 0;                                                                                                     \
+        for (j = 0; j < n_locks; j += n)                                                                           \
+        {                                                                                                          \
+            /* vault bits are read a word at a time, source bits a run at a time */                                \
+            if (j % LOCK_WORD_BITS == 0)                                                                           \
+                word = get_bits(                                                                                   \
+                    vault, key_indexes[i] * n_locks + j,                                                           \
+                    n_locks - j < LOCK_WORD_BITS ? n_locks - j : LOCK_WORD_BITS);                                  \
+            n = n_locks - j < EARLY_EXIT_LOCKS ? n_locks - j : EARLY_EXIT_LOCKS;                                   \
+            mask = gather(source, source_indexes + i * di + j * n_xoration, n, n_xoration);                        \
+            c += popcount64((word >> (j % LOCK_WORD_BITS) ^ mask) & (~0ULL >> (64 - n)));                          \
+                                                                                                                   \
+            /* stop once the remaining locks cannot change the majority */                                         \
+            if (c > mid || c + (n_locks - j - n) <= mid)                                                           \
+            {                                                                                                      \
+                skipped += n_locks - j - n;                                                                        \
+                break;                                                                                             \
+            }                                                                                                      \
+        }                                                                                                          \
+        set_bit_v(key, i, c > mid);                                                                                \
+    }                                                                                                              \
+                                                                                                                   \
+    return skipped;                                                                                                \
+}                                                                                                                  \
+                                                                                                                   \
+void unlock_soft##W(                                                                                               \
+    unsigned char *source,                                                                                         \
+    T *source_indexes,                                                                                             \
+    unsigned char *vault,                                                                                          \
+    unsigned char *key,                                                                                            \
+    T *key_indexes,                                                                                                \
+    unsigned int key_bits,                                                                                         \
+    unsigned int n_locks,                                                                                          \
+    unsigned int n_xoration,                                                                                       \
+    unsigned char *e_map)                                                                                          \
+{                                                                                                                  \
+    unsigned int i, j, k, cost, bit;                                                                               \
+    unsigned long votes[2];                                                                                        \
+    T *idx;                                                                                                        \
+                                                                                                                   \
+    pthread_once(&soft_once, soft_setup);                                                                          \
+                                                                                                                   \
+    for (i = 0; i < key_bits; i++)                                                                                 \
+    {                                                                                                              \
+        votes[0] = votes[1] = 0;                                                                                   \
+        idx = source_indexes + (size_t)i * n_locks * n_xoration;                                                   \
+        for (j = 0; j < n_locks; j++)                                                                              \
+        {                                                                                                          \
+            bit = get_bit(vault, key_indexes[i] * n_locks + j);                                                    \
+            cost = 0;                                                                                              \
+            for (k = 0; k < n_xoration; k++, idx++)                                                                \
+            {                                                                                                      \
+                bit ^= get_bit(source, *idx);                                                                      \
+                cost += soft_cost[e_map[*idx]];                                                                    \
+            }                                                                                                      \
+            votes[bit] += soft_weight[cost < SOFT_COSTS ? cost : SOFT_COSTS - 1];                                  \
+        }                                                                                                          \
+        set_bit_v(key, i, votes[1] > votes[0]);                                                                    \
+    }                                                                                                              \
+}
+
+LOCKER_KERNELS(, unsigned int)
+LOCKER_KERNELS(16, uint16_t)
+
 void lock(
     unsigned char *source,
     unsigned int *source_indexes,
@@ -287,60 +862,7 @@ void lock(
     unsigned int n_xoration,
     unsigned char *vault)
 {
-    unsigned char b, t0;
-    unsigned int i, j, k, ijk = 0;
-    for (i = 0; i < pool_bits; i++)
-    {
-        b = get_bit(pool, i);
-        for (j = 0; j < n_locks; j++)
-        {
-            t0 = b;
-            for (k = 0; k < n_xoration; k++)
-            {
-                t0 ^= get_bit(source, source_indexes[ijk++]);
-            }
-            set_bit_v_2D(vault, i, j, n_locks, t0);
-        }
-    }
-}
-
-void unlock(
-    unsigned char *source,
-    unsigned int *source_indexes,
-    unsigned char *vault,
-    unsigned char *key,
-    unsigned int *key_indexes,
-    unsigned int key_bits,
-    unsigned int n_locks,
-    unsigned int n_xoration)
-{
-    unsigned char b;
-    unsigned int i0, i1;
-    unsigned int i, j, k;
-    int c;
-    int mid = n_locks / 2;
-    int di = n_locks * n_xoration;
-
-    for (i = 0; i < key_bits; i++)
-    {
-        i0 = key_indexes[i];
-        c = 0;
-        for (j = 0; j < n_locks; j++)
-        {
-            b = get_bit_2D(vault, i0, j, n_locks);
-            for (k = 0; k < n_xoration; k++)
-            {
-                i1 = get_int_3D(source_indexes, i0, j, k, di, n_xoration);
-                b ^= get_bit(source, i1);
-            }
-            if (b)
-                c++;
-        }
-        if (c > mid)
-            set_bit_v(key, i, 1);
-        else
-            set_bit_v(key, i, 0);
-    }
+    lock_range(source, source_indexes, pool, 0, pool_bits, n_locks, n_xoration, vault);
 }
 
 void init(
@@ -355,12 +877,22 @@ void init(
     unsigned int n_locks,
     unsigned int n_xoration)
 {
-    unsigned int source_indexes[pool_bits * n_locks * n_xoration];
-
     init_random(source, source_bytes);
     init_random(pool, pool_bytes);
-    prng_rand_without_replacement(source_seed, pool_bits * n_locks * n_xoration, source_indexes, 0, source_bits);
-    lock(source, source_indexes, pool, pool_bits, n_locks, n_xoration, vault);
+    if (source_bits <= INDEX16_BITS)
+    {
+        uint16_t source_indexes[ENROLL_LOCKERS * n_locks * n_xoration];
+        enroll16(
+            source, source_seed, source_bits, pool, pool_bits, vault,
+            n_locks, n_xoration, source_indexes, ENROLL_LOCKERS);
+    }
+    else
+    {
+        unsigned int source_indexes[ENROLL_LOCKERS * n_locks * n_xoration];
+        enroll(
+            source, source_seed, source_bits, pool, pool_bits, vault,
+            n_locks, n_xoration, source_indexes, ENROLL_LOCKERS);
+    }
 }
 
 double gen(
@@ -379,8 +911,12 @@ double gen(
     unsigned int n_locks,
     unsigned int n_xoration)
 {
-    unsigned char key_pre[bits_to_bytes(key_pre_bits)];
-    unsigned int source_indexes[pool_bits * n_locks * n_xoration], key_indexes[key_pre_bits], md_len;
+    struct xlock_params params = {
+        source_bits, pool_bits, key_bits, key_pre_bits,
+        token_bytes, n_locks, n_xoration};
+    struct xlock_ctx ctx;
+    unsigned char *buf;
+    int ret;
 
 #ifdef _SPEED_
     /* start execution time evaluation */
@@ -388,45 +924,14 @@ double gen(
     TIC(start);
 #endif
 
-    /* generate sets of indexes */
-    prng_rand_without_replacement(source_seed, pool_bits * n_locks * n_xoration, source_indexes, 0, source_bits);
-    prng_rand_without_replacement(key_seed, key_pre_bits, key_indexes, 0, pool_bits);
-
-    /* generate key_pre */
-    unlock(
-        read, source_indexes, vault,
-        key_pre, key_indexes, key_pre_bits,
-        n_locks, n_xoration);
-
-#ifdef _VERBOSE_
-    printf("key pre gen (%u bytes)\t\t\t: ", bits_to_bytes(key_pre_bits));
-    for (int i = 0; i < bits_to_bytes(key_pre_bits); i++)
-    {
-        printf("%x", key_pre[i]);
-    }
-    printf("\n");
-#endif
-
-    /* generate nonce for final key */
-    srand(time(NULL));
-    *nonce = (unsigned long)rand();
-
-    /* key = hash(key_pre, noce) */
-    md_len = bits_to_bytes(key_bits);
-    HMAC(EVP_sha256(), nonce, sizeof(unsigned long), key_pre, bits_to_bytes(key_pre_bits), key, &md_len);
-
-    /* token = hash(key, key_seed) */
-    md_len = token_bytes;
-    HMAC(EVP_sha256(), key_seed, sizeof(unsigned long), key, bits_to_bytes(key_bits), token, &md_len);
-
-#ifdef _VERBOSE_
-    printf("robustness token (%u bytes)\t\t: ", token_bytes);
-    for (int i = 0; i < token_bytes; i++)
-    {
-        printf("%x", token[i]);
-    }
-    printf("\n");
-#endif
+    /* params are validated before they size the scratch */
+    if (xlock_params_check(&params) || !(buf = malloc(xlock_ctx_size(&params))))
+        return -1;
+    ret = xlock_ctx_init(&ctx, &params, buf, xlock_ctx_size(&params)) ||
+          xlock_ctx_gen(&ctx, read, source_seed, vault, key, key_seed, nonce, token);
+    free(buf);
+    if (ret)
+        return -1;
 
 #ifdef _SPEED_
     /* stop execution time evaluation */
@@ -453,8 +958,12 @@ double rep(
     unsigned int n_locks,
     unsigned int n_xoration)
 {
-    unsigned char key_pre[bits_to_bytes(key_pre_bits)], T[token_bytes];
-    unsigned int i, md_len, source_indexes[pool_bits * n_locks * n_xoration], key_indexes[key_pre_bits];
+    struct xlock_params params = {
+        source_bits, pool_bits, key_bits, key_pre_bits,
+        token_bytes, n_locks, n_xoration};
+    struct xlock_ctx ctx;
+    unsigned char *buf;
+    int ret;
 
 #ifdef _SPEED_
     /* start execution time evaluation */
@@ -462,45 +971,15 @@ double rep(
     TIC(start);
 #endif
 
-    /* generate sets of indexes */
-    prng_rand_without_replacement(source_seed, pool_bits * n_locks * n_xoration, source_indexes, 0, source_bits);
-    prng_rand_without_replacement(key_seed, key_pre_bits, key_indexes, 0, pool_bits);
-
-    /* generate key_pre */
-    unlock(
-        read, source_indexes, vault,
-        key_pre, key_indexes, key_pre_bits,
-        n_locks, n_xoration);
-
-#ifdef _VERBOSE_
-    printf("key pre rep (%u bytes)\t\t\t: ", bits_to_bytes(key_pre_bits));
-    for (i = 0; i < bits_to_bytes(key_pre_bits); i++)
-    {
-        printf("%x", key_pre[i]);
-    }
-    printf("\n");
-#endif
-
-    /* key = hash(key_pre, noce) */
-    md_len = bits_to_bytes(key_bits);
-    HMAC(EVP_sha256(), nonce, sizeof(unsigned long), key_pre, bits_to_bytes(key_pre_bits), key, &md_len);
-
-    /* token = hash(key, key_seed) */
-    md_len = token_bytes;
-    HMAC(EVP_sha256(), key_seed, sizeof(unsigned long), key, bits_to_bytes(key_bits), T, &md_len);
-
-    /* check if T != T' */
-    if (strncmp((char *)T, (char *)token, token_bytes))
-    {
-#ifdef _VERBOSE_
-        printf("T != computed T\n");
-#endif
-        for (i = 0; i < bits_to_bytes(key_bits); i++)
-        {
-            key[i] = 0;
-        }
-        key = NULL;
-    }
+    /* params are validated before they size the scratch */
+    if (xlock_params_check(&params) || !(buf = malloc(xlock_ctx_size(&params))))
+        return -1;
+    ret = xlock_ctx_init(&ctx, &params, buf, xlock_ctx_size(&params));
+    if (!ret)
+        xlock_ctx_rep(&ctx, read, source_seed, vault, key, key_seed, nonce, token);
+    free(buf);
+    if (ret)
+        return -1;
 
 #ifdef _SPEED_
     /* stop execution time evaluation */
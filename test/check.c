@@ -0,0 +1,372 @@
+/**
+ * @file check.c
+ * @brief Focused checks of the test build
+ *
+ * This file implements the checks of HMAC-SHA256, records, stores and
+ * stable bits. Devices are enrolled with the parameters of the test
+ * program, and reproduced from their enrollment reading, so that every
+ * mismatch is a bug rather than noise.
+ */
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <fcntl.h>
+
+#include "../include/bits.h"
+#include "../include/context.h"
+#include "../include/hmac.h"
+#include "../include/record.h"
+#include "../include/stable.h"
+#include "../include/store.h"
+#include "../include/xlock.h"
+#include "check.h"
+
+/**
+ * @brief source length in bytes of the checked devices
+ */
+#define CHECK_SOURCE_BYTES 8004
+
+/**
+ * @brief key length in bytes of the checked devices
+ */
+#define CHECK_KEY_BYTES 32
+
+/**
+ * @brief robustness token length in bytes of the checked devices
+ */
+#define CHECK_TOKEN_BYTES 32
+
+/**
+ * @brief devices put into the checked store
+ */
+#define CHECK_DEVICES 8
+
+/**
+ * @brief Prints a failed step and jumps to the cleanup of the check.
+ */
+#define CHECK(cond, what)                       \
+    do                                          \
+    {                                           \
+        if (!(cond))                            \
+        {                                       \
+            printf("check failed: %s\n", what); \
+            goto out;                           \
+        }                                       \
+    } while (0)
+
+/**
+ * @brief HMAC-SHA256 test case of RFC 4231
+ *
+ * Keys and messages are given in hex, or as fill bytes repeated len
+ * times when the hex string is NULL.
+ */
+struct check_hmac_case
+{
+    const char *key;      /**< key in hex, or NULL */
+    unsigned char key_b;  /**< fill byte of the key */
+    size_t key_len;       /**< key length in bytes */
+    const char *data;     /**< message, or NULL */
+    unsigned char data_b; /**< fill byte of the message */
+    size_t data_len;      /**< message length in bytes */
+    const char *mac;      /**< HMAC-SHA256 in hex */
+};
+
+/**
+ * @brief test cases 1-4, 6 and 7 of RFC 4231, case 5 being truncated
+ */
+struct check_hmac_case check_hmac_cases[] = {
+    {NULL, 0x0b, 20, "Hi There", 0, 8,
+     "b0344c61d8db38535ca8afceaf0bf12b881dc200c9833da726e9376c2e32cff7"},
+    {"4a656665", 0, 4, "what do ya want for nothing?", 0, 28,
+     "5bdcc146bf60754e6a042426089575c75a003f089d2739839dec58b964ec3843"},
+    {NULL, 0xaa, 20, NULL, 0xdd, 50,
+     "773ea91e36800e46854db8ebd09181a72959098b3ef8c122d9635514ced565fe"},
+    {"0102030405060708090a0b0c0d0e0f10111213141516171819", 0, 25, NULL, 0xcd, 50,
+     "82558a389a443c0ea4cc819899f2083a85f0faa3e578f8077a2e3ff46729665b"},
+    {NULL, 0xaa, 131, "Test Using Larger Than Block-Size Key - Hash Key First", 0, 54,
+     "60e431591ee0b67f0d8a26aacbf5b77f8e0bc6213728c5140546040f0ee37f54"},
+    {NULL, 0xaa, 131,
+     "This is a test using a larger than block-size key and a larger than "
+     "block-size data. The key needs to be hashed before being used by the "
+     "HMAC algorithm.",
+     0, 152,
+     "9b09ffa71b942fcb27635fbcd5b0e944bfdc63644f0713938a7f51535c3a35e2"},
+};
+
+/**
+ * @brief decodes a hex string
+ *
+ * @param hex hex string of 2 * len digits
+ * @param b storage for len bytes
+ * @param len number of bytes
+ * @return void
+ */
+void check_unhex(const char *hex, unsigned char *b, size_t len)
+{
+    size_t i;
+    unsigned int v;
+
+    for (i = 0; i < len; i++)
+    {
+        sscanf(hex + 2 * i, "%2x", &v);
+        b[i] = v;
+    }
+}
+
+int check_hmac(void)
+{
+    struct check_hmac_case *c;
+    unsigned char key[131], data[152], mac[HMAC_BYTES], md[HMAC_BYTES];
+    size_t i;
+    int ret = -1;
+
+    for (i = 0; i < sizeof(check_hmac_cases) / sizeof(check_hmac_cases[0]); i++)
+    {
+        c = &check_hmac_cases[i];
+        if (c->key)
+            check_unhex(c->key, key, c->key_len);
+        else
+            memset(key, c->key_b, c->key_len);
+        if (c->data)
+            memcpy(data, c->data, c->data_len);
+        else
+            memset(data, c->data_b, c->data_len);
+        check_unhex(c->mac, mac, HMAC_BYTES);
+
+        CHECK(!hmac_sha256(key, c->key_len, data, c->data_len, md), "hmac_sha256");
+        CHECK(!memcmp(md, mac, HMAC_BYTES), "hmac_sha256 against RFC 4231");
+    }
+
+    ret = 0;
+out:
+    return ret;
+}
+
+/**
+ * @brief enrolled device
+ */
+struct check_device
+{
+    unsigned char source[CHECK_SOURCE_BYTES]; /**< enrollment reading */
+    unsigned char pool[32];                   /**< random pool */
+    unsigned char vault[2048];                /**< vault */
+    unsigned char key[CHECK_KEY_BYTES];       /**< generated key */
+    unsigned char token[CHECK_TOKEN_BYTES];   /**< robustness token */
+    unsigned long source_seed;                /**< source seed */
+    unsigned long key_seed;                   /**< key seed */
+    unsigned long nonce;                      /**< nonce */
+};
+
+/**
+ * @brief parameters of the checked devices, as in the test program
+ */
+struct xlock_params check_params = {CHECK_SOURCE_BYTES * 8, 256, 256, 80, CHECK_TOKEN_BYTES, 64, 2};
+
+/**
+ * @brief enrolls a device and generates its key
+ *
+ * @param ctx context
+ * @param dev device storage
+ * @param seed distinct non-zero seed of the device
+ * @return 0 on success, -1 otherwise
+ */
+int check_enroll(struct xlock_ctx *ctx, struct check_device *dev, unsigned long seed)
+{
+    init_random(dev->source, CHECK_SOURCE_BYTES);
+    init_random(dev->pool, sizeof(dev->pool));
+    dev->source_seed = seed;
+    dev->key_seed = seed + 1;
+    dev->nonce = 0;
+
+    if (xlock_ctx_enroll(ctx, dev->source, &dev->source_seed, dev->pool, dev->vault))
+        return -1;
+    return xlock_ctx_gen(
+        ctx, dev->source, &dev->source_seed, dev->vault,
+        dev->key, &dev->key_seed, &dev->nonce, dev->token);
+}
+
+/**
+ * @brief writes the record of a device
+ *
+ * @param dev device
+ * @param rec record storage
+ * @param size size of rec in bytes
+ * @return 0 on success, -1 otherwise
+ */
+int check_write(struct check_device *dev, struct xlock_record *rec, size_t size)
+{
+    return xlock_record_write(
+        rec, size, &check_params, dev->source_seed, dev->key_seed,
+        dev->nonce, dev->vault, dev->token, NULL);
+}
+
+int check_record(void)
+{
+    struct xlock_ctx ctx;
+    struct check_device dev;
+    unsigned char key[CHECK_KEY_BYTES];
+    size_t size = xlock_record_size(&check_params, 0);
+    size_t scratch = xlock_ctx_size(&check_params);
+    void *buf = malloc(scratch);
+    uint64_t *rec = malloc(size + XLOCK_RECORD_ALIGN);
+    int ret = -1;
+
+    CHECK(buf && rec, "record memory");
+    CHECK(!xlock_ctx_init(&ctx, &check_params, buf, scratch), "record context");
+    CHECK(!check_enroll(&ctx, &dev, 11), "record enrollment");
+
+    CHECK(check_write(&dev, (struct xlock_record *)rec, size - 1), "record write into a short buffer fails");
+    CHECK(!check_write(&dev, (struct xlock_record *)rec, size), "record write");
+    CHECK(!xlock_record_check((struct xlock_record *)rec, size), "record check");
+    CHECK(!xlock_record_rep(&ctx, (struct xlock_record *)rec, dev.source, key), "record rep");
+    CHECK(!memcmp(key, dev.key, CHECK_KEY_BYTES), "record rep key");
+
+    /* truncated records */
+    CHECK(xlock_record_check((struct xlock_record *)rec, size - 1), "truncated record rejected");
+    CHECK(xlock_record_check((struct xlock_record *)rec, sizeof(struct xlock_record) - 1), "truncated header rejected");
+
+    /* misaligned records */
+    memmove((unsigned char *)rec + 1, rec, size);
+    CHECK(xlock_record_check((struct xlock_record *)((unsigned char *)rec + 1), size), "misaligned record rejected");
+    memmove(rec, (unsigned char *)rec + 1, size);
+    CHECK(!xlock_record_check((struct xlock_record *)rec, size), "realigned record check");
+
+    /* a corrupted layout */
+    ((struct xlock_record *)rec)->token += XLOCK_RECORD_ALIGN;
+    CHECK(xlock_record_check((struct xlock_record *)rec, size), "record with a moved token rejected");
+
+    ret = 0;
+out:
+    free(rec);
+    free(buf);
+    return ret;
+}
+
+int check_store(void)
+{
+    struct xlock_ctx ctx;
+    struct xlock_store store;
+    struct xlock_store_header header;
+    struct check_device *devs = malloc(CHECK_DEVICES * sizeof(struct check_device));
+    struct xlock_record *got;
+    unsigned char key[CHECK_KEY_BYTES];
+    char path[] = "/tmp/xlock-check-XXXXXX";
+    size_t size = xlock_record_size(&check_params, 0);
+    size_t scratch = xlock_ctx_size(&check_params);
+    void *buf = malloc(scratch);
+    uint64_t *rec = malloc(size);
+    unsigned int i;
+    int fd = mkstemp(path), opened = 0, ret = -1;
+
+    CHECK(devs && buf && rec && fd >= 0, "store memory");
+    close(fd);
+    CHECK(!xlock_ctx_init(&ctx, &check_params, buf, scratch), "store context");
+
+    CHECK(!xlock_store_create(&store, path, CHECK_DEVICES, size), "store create");
+    opened = 1;
+    for (i = 0; i < CHECK_DEVICES; i++)
+    {
+        CHECK(!check_enroll(&ctx, &devs[i], 100 + 2 * i), "store enrollment");
+        CHECK(!check_write(&devs[i], (struct xlock_record *)rec, size), "store record write");
+        CHECK(!xlock_store_put(&store, 1000 + i, (struct xlock_record *)rec), "store put");
+    }
+    CHECK(store.header->count == CHECK_DEVICES, "store count");
+    CHECK(xlock_store_put(&store, 2000, (struct xlock_record *)rec), "put into a full store fails");
+
+    /* replacing device 0 with a new enrollment keeps the count */
+    CHECK(!check_enroll(&ctx, &devs[0], 200), "store re-enrollment");
+    CHECK(!check_write(&devs[0], (struct xlock_record *)rec, size), "store record rewrite");
+    CHECK(!xlock_store_put(&store, 1000, (struct xlock_record *)rec), "store replace");
+    CHECK(store.header->count == CHECK_DEVICES, "store count after replace");
+    xlock_store_close(&store);
+    opened = 0;
+
+    CHECK(!xlock_store_open(&store, path, 0), "store open");
+    opened = 1;
+    for (i = 0; i < CHECK_DEVICES; i++)
+    {
+        got = xlock_store_get(&store, 1000 + i);
+        CHECK(got && got->source_seed == devs[i].source_seed && got->key_seed == devs[i].key_seed, "store get");
+        CHECK(!xlock_store_rep(&ctx, &store, 1000 + i, devs[i].source, key), "store rep");
+        CHECK(!memcmp(key, devs[i].key, CHECK_KEY_BYTES), "store rep key");
+    }
+    CHECK(!xlock_store_get(&store, 2000), "unknown device not found");
+    xlock_store_close(&store);
+    opened = 0;
+
+    /* a slot table past the end of the file */
+    fd = open(path, O_RDWR);
+    CHECK(fd >= 0 && pread(fd, &header, sizeof(header), 0) == sizeof(header), "store header read");
+    header.slots = 1ULL << 60;
+    CHECK(pwrite(fd, &header, sizeof(header), 0) == sizeof(header), "store header write");
+    close(fd);
+    CHECK(xlock_store_open(&store, path, 0), "store with a corrupt header rejected");
+
+    ret = 0;
+out:
+    if (opened)
+        xlock_store_close(&store);
+    unlink(path);
+    free(rec);
+    free(buf);
+    free(devs);
+    return ret;
+}
+
+int check_stable(void)
+{
+    struct xlock_stable stable;
+    unsigned int source_bits = 8 * 1000 + 5, density, i, k, n;
+    unsigned char bitmap[1001];
+    size_t size = xlock_stable_size(source_bits);
+    void *buf = malloc(size);
+    uint64_t w;
+    int ret = -1;
+
+    CHECK(buf, "stable memory");
+
+    /* from every bit stable down to one in 64 */
+    for (density = 64; density; density /= 2)
+    {
+        memset(bitmap, 0, sizeof(bitmap));
+        for (i = 0; i < source_bits; i++)
+            set_bit_v(bitmap, i, rand() % 64 < (int)density);
+        CHECK(!xlock_stable_init(&stable, bitmap, source_bits, buf, size), "stable init");
+
+        for (i = 0, k = 0; i < source_bits; i++)
+        {
+            CHECK(xlock_stable_rank(&stable, i) == k, "stable rank against a naive scan");
+            if (get_bit(bitmap, i))
+            {
+                CHECK(xlock_stable_select(&stable, k) == i, "stable select against a naive scan");
+                k++;
+            }
+        }
+        CHECK(stable.n_stable == k && xlock_stable_rank(&stable, source_bits) == k, "stable count");
+    }
+
+    /* select within a word, with and without BMI2 */
+    for (i = 0; i < 10000; i++)
+    {
+        w = (uint64_t)rand() << 62 ^ (uint64_t)rand() << 31 ^ (uint64_t)rand();
+        if (!w)
+            continue;
+        n = popcount64(w);
+        for (k = 0; k < n; k++)
+        {
+            CHECK(w >> stable_select64(w, k) & 1, "select64 lands on a set bit");
+            CHECK(popcount64(w & ((1ULL << stable_select64(w, k)) - 1)) == k, "select64 rank");
+#ifdef GATHER_X86
+            if (__builtin_cpu_supports("bmi2"))
+                CHECK(stable_select64_bmi2(w, k) == stable_select64(w, k), "select64 against BMI2");
+#endif
+        }
+    }
+
+    ret = 0;
+out:
+    free(buf);
+    return ret;
+}
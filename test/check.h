@@ -0,0 +1,41 @@
+#ifndef CHECK_H
+#define CHECK_H
+
+/**
+ * @file check.h
+ * @brief Focused checks of the test build
+ *
+ * This file exposes checks of single modules, run by the test program
+ * before its experiments. Every check returns 0 on success and -1 on
+ * the first mismatch, printed with the failing step.
+ */
+
+/**
+ * @brief checks HMAC-SHA256 against the test cases of RFC 4231
+ *
+ * @return 0 on success, -1 otherwise
+ */
+int check_hmac(void);
+
+/**
+ * @brief checks record write, validation and reproduction
+ *
+ * @return 0 on success, -1 otherwise
+ */
+int check_record(void);
+
+/**
+ * @brief checks store put, replace, get and header validation
+ *
+ * @return 0 on success, -1 otherwise
+ */
+int check_store(void);
+
+/**
+ * @brief checks rank/select over stable bits against a naive scan
+ *
+ * @return 0 on success, -1 otherwise
+ */
+int check_stable(void);
+
+#endif
@@ -5,7 +5,9 @@
 
 #include "../include/bits.h"
 #include "../include/indexes.h"
+#include "../include/stats.h"
 #include "../include/xlock.h"
+#include "check.h"
 
 #define HASH_KEY_BYTES 32
 #define TOKEN_BYTES 32
@@ -49,6 +51,9 @@ int main()
     /* prepare measurements */
     double time_gen = 0, time_rep = 0;
     double mean_gen = 0, mean_rep = 0;
+    struct xlock_stats stats;
+    unsigned int p;
+    xlock_stats_enable(1);
 #else
     /* for compiler's happiness */
     res = res * 2;
@@ -64,6 +69,11 @@ int main()
     prng_rand_without_replacement(&key1_seed, look_up_size, key_seeds, 1, pow(2, 20));
     prng_rand_without_replacement(&source_seed, look_up_size, source_seeds, 1, pow(2, 20));
 
+    /* focused checks first, the experiments assume them */
+    if (check_hmac() || check_record() || check_store() || check_stable())
+        return 1;
+    printf("Checks\t\t: passed\n");
+
     printf("\n-----------params-----------\nkey_pre\t\t: %u\ne_abs\t\t: %f\nC\t\t: %u\nL\t\t: %d\n-----------params-----------\n", key_pre_bits, e_abs, n_xoration, n_locks);
 
     unsigned int i, j;
@@ -150,6 +160,15 @@ int main()
     printf("Mean Gen ms\t: %f\n", mean_gen);
     printf("Mean Rep ms\t: %f\n", mean_rep);
     printf("Mean Tot ms\t: %f\n", mean_gen + mean_rep);
+
+    /* phases of gen and rep together */
+    xlock_stats_thread(&stats);
+    for (p = 0; p < XLOCK_PHASES; p++)
+    {
+        printf("Mean %s us\t: %f (%.0f cycles)\n", xlock_phase_name(p),
+               stats.phases[p].runs ? (double)stats.phases[p].ns / stats.phases[p].runs / 1000 : 0,
+               stats.phases[p].runs ? (double)stats.phases[p].cycles / stats.phases[p].runs : 0);
+    }
 #endif
 
     return 0;